@@ -0,0 +1,80 @@
+// dpiCleanup_nif.c
+// Thread de limpeza compartilhada pelos NIFs. Quem precisa encerrar uma
+// thread de busca, fechar um cursor ou devolver uma conexão a partir de um
+// destrutor enfileira a tarefa aqui e retorna na hora; a thread executa as
+// tarefas em ordem, fora dos schedulers do Erlang.
+
+#include "dpiCleanup_nif.h"
+
+typedef struct cleanup_job cleanup_job;
+
+struct cleanup_job {
+  cleanup_fn fn;
+  void *arg;
+  cleanup_job *next;
+};
+
+static ErlNifMutex *cleanup_lock;
+static ErlNifCond *cleanup_cond;
+static ErlNifTid cleanup_thread;
+static cleanup_job *cleanup_first;
+static cleanup_job *cleanup_last;
+
+
+static void *cleanup_run(void *arg)
+{
+  cleanup_job *job;
+
+  while (1) {
+    enif_mutex_lock(cleanup_lock);
+    while (!cleanup_first)
+      enif_cond_wait(cleanup_cond, cleanup_lock);
+    job = cleanup_first;
+    cleanup_first = job->next;
+    if (!cleanup_first)
+      cleanup_last = NULL;
+    enif_mutex_unlock(cleanup_lock);
+
+    job->fn(job->arg);
+    enif_free(job);
+  }
+  return NULL;
+}
+
+
+// A thread vive enquanto a biblioteca estiver carregada (não há unload).
+int cleanup_load(ErlNifEnv *env)
+{
+  cleanup_lock = enif_mutex_create("oracle_nif_cleanup_lock");
+  cleanup_cond = enif_cond_create("oracle_nif_cleanup_cond");
+  if (!cleanup_lock || !cleanup_cond ||
+      enif_thread_create("oracle_nif_cleanup", &cleanup_thread, cleanup_run,
+          NULL, NULL) != 0)
+    return -1;
+  return 0;
+}
+
+
+// Sem memória para a tarefa, ela é executada ali mesmo: melhor bloquear o
+// scheduler do que vazar a thread ou o cursor.
+void cleanup_schedule(cleanup_fn fn, void *arg)
+{
+  cleanup_job *job;
+
+  job = enif_alloc(sizeof(cleanup_job));
+  if (!job) {
+    fn(arg);
+    return;
+  }
+  job->fn = fn;
+  job->arg = arg;
+  job->next = NULL;
+  enif_mutex_lock(cleanup_lock);
+  if (cleanup_last)
+    cleanup_last->next = job;
+  else
+    cleanup_first = job;
+  cleanup_last = job;
+  enif_cond_signal(cleanup_cond);
+  enif_mutex_unlock(cleanup_lock);
+}
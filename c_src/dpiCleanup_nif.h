@@ -0,0 +1,14 @@
+#ifndef DPICLEANUP_NIF_H
+#define DPICLEANUP_NIF_H
+
+#include <erl_nif.h>
+
+// Limpeza adiada: destrutores de recursos rodam em schedulers normais e não
+// podem esperar threads nem fazer idas ao banco. O trabalho é enfileirado
+// para uma thread própria, criada no load da biblioteca.
+typedef void (*cleanup_fn)(void *arg);
+
+int cleanup_load(ErlNifEnv *env);
+void cleanup_schedule(cleanup_fn fn, void *arg);
+
+#endif
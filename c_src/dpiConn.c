@@ -28,6 +28,43 @@ static int dpiConn__setAttributesFromCreateParams(void *handle,
         const dpiConnCreateParams *params, dpiError *error);
 
 
+//-----------------------------------------------------------------------------
+// dpiConn__cacheTempLob() [INTERNAL]
+//   Keep the temporary LOB of a LOB being closed so that it can be handed to
+// the next temporary LOB of the same type created on the connection, instead
+// of freeing it now and creating another one later. The contents are kept as
+// well, which is why dpiLob__close() only offers small temporary LOBs;
+// whoever reuses the temporary LOB empties or overwrites it. If the
+// cache is full or the connection is closed, the temporary LOB is not kept
+// and must be freed by the caller.
+//-----------------------------------------------------------------------------
+int dpiConn__cacheTempLob(dpiConn *conn, const dpiOracleType *type,
+        void *locator, int *cached, dpiError *error)
+{
+    *cached = 0;
+    if (conn->env->threaded &&
+            dpiOci__threadMutexAcquire(conn->env, error) < 0)
+        return DPI_FAILURE;
+    if (conn->handle && !conn->closing) {
+        if (!conn->tempLobs)
+            conn->tempLobs = calloc(DPI_TEMP_LOB_CACHE_SIZE,
+                    sizeof(dpiTempLob));
+        if (conn->tempLobs && conn->numTempLobs < DPI_TEMP_LOB_CACHE_SIZE) {
+            conn->tempLobs[conn->numTempLobs].locator = locator;
+            conn->tempLobs[conn->numTempLobs].oracleTypeNum =
+                    type->oracleTypeNum;
+            conn->numTempLobs++;
+            *cached = 1;
+        }
+    }
+    if (conn->env->threaded &&
+            dpiOci__threadMutexRelease(conn->env, error) < 0)
+        return DPI_FAILURE;
+
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiConn__checkConnected() [INTERNAL]
 //   Validate the connection handle and determine the error structure to use.
@@ -44,6 +81,31 @@ static int dpiConn__checkConnected(dpiConn *conn, const char *fnName,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiConn__clearTempLobs() [INTERNAL]
+//   Free all of the temporary LOBs kept by the connection for reuse. They are
+// only valid for the life of the session so this is done in a single pass as
+// the connection is closed, before the session is ended or released.
+//-----------------------------------------------------------------------------
+static int dpiConn__clearTempLobs(dpiConn *conn, int propagateErrors,
+        dpiError *error)
+{
+    dpiTempLob *tempLob;
+    int status;
+
+    while (conn->numTempLobs > 0) {
+        tempLob = &conn->tempLobs[--conn->numTempLobs];
+        status = dpiOci__lobFreeTemporary(conn, tempLob->locator,
+                propagateErrors, error);
+        dpiOci__descriptorFree(tempLob->locator, DPI_OCI_DTYPE_LOB);
+        if (status < 0)
+            return DPI_FAILURE;
+    }
+
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiConn__close() [INTERNAL]
 //   Internal method used for closing the connection. Any transaction is rolled
@@ -62,6 +124,10 @@ static int dpiConn__close(dpiConn *conn, int mode, const char *tag,
     if (dpiOci__transRollback(conn, propagateErrors, error) < 0)
         return DPI_FAILURE;
 
+    // free temporary LOBs kept for reuse
+    if (dpiConn__clearTempLobs(conn, propagateErrors, error) < 0)
+        return DPI_FAILURE;
+
     // handle standalone connections
     if (conn->standalone) {
 
@@ -240,6 +306,10 @@ void dpiConn__free(dpiConn *conn, dpiError *error)
     if (conn->handle)
         dpiConn__close(conn, DPI_MODE_CONN_CLOSE_DEFAULT, NULL, 0, 0,
                 error);
+    if (conn->tempLobs) {
+        free(conn->tempLobs);
+        conn->tempLobs = NULL;
+    }
     if (conn->pool) {
         dpiGen__setRefCount(conn->pool, error, -1);
         conn->pool = NULL;
@@ -458,6 +528,17 @@ static int dpiConn__getSession(dpiConn *conn, uint32_t mode,
         if (dpiConn__getHandles(conn, error) < 0)
             return DPI_FAILURE;
 
+        // get last time used from session context; it is only set when a
+        // session is released back to the pool so if it is missing, the
+        // session was newly created
+        lastTimeUsed = NULL;
+        if (conn->pool && dpiOci__contextGetValue(conn,
+                DPI_CONTEXT_LAST_TIME_USED,
+                (uint32_t) strlen(DPI_CONTEXT_LAST_TIME_USED),
+                (void**) &lastTimeUsed, 1, error) < 0)
+            return DPI_FAILURE;
+        params->outNewSession = !lastTimeUsed;
+
         // Oracle client 12.2 already has better support so do nothing in
         // that case
         if (conn->env->versionInfo->versionNum > 12 ||
@@ -465,13 +546,6 @@ static int dpiConn__getSession(dpiConn *conn, uint32_t mode,
                 conn->env->versionInfo->releaseNum >= 2))
             break;
 
-        // get last time used from session context
-        lastTimeUsed = NULL;
-        if (dpiOci__contextGetValue(conn, DPI_CONTEXT_LAST_TIME_USED,
-                (uint32_t) strlen(DPI_CONTEXT_LAST_TIME_USED),
-                (void**) &lastTimeUsed, 1, error) < 0)
-            return DPI_FAILURE;
-
         // if value is not found, a new connection has been created and there
         // is no need to perform a ping; nor if we are creating a standalone
         // connection
@@ -696,6 +770,35 @@ int dpiConn__setAttributeText(dpiConn *conn, uint32_t attribute,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiConn__takeTempLob() [INTERNAL]
+//   Remove a temporary LOB of the given type from those kept by the connection
+// for reuse and return its locator, or NULL if there are none.
+//-----------------------------------------------------------------------------
+int dpiConn__takeTempLob(dpiConn *conn, const dpiOracleType *type,
+        void **locator, dpiError *error)
+{
+    uint32_t i;
+
+    *locator = NULL;
+    if (conn->env->threaded &&
+            dpiOci__threadMutexAcquire(conn->env, error) < 0)
+        return DPI_FAILURE;
+    for (i = conn->numTempLobs; i > 0; i--) {
+        if (conn->tempLobs[i - 1].oracleTypeNum == type->oracleTypeNum) {
+            *locator = conn->tempLobs[i - 1].locator;
+            conn->tempLobs[i - 1] = conn->tempLobs[--conn->numTempLobs];
+            break;
+        }
+    }
+    if (conn->env->threaded &&
+            dpiOci__threadMutexRelease(conn->env, error) < 0)
+        return DPI_FAILURE;
+
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiConn_addRef() [PUBLIC]
 //   Add a reference to the connection.
@@ -1160,6 +1263,30 @@ int dpiConn_getInternalName(dpiConn *conn, const char **value,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiConn_getIsHealthy() [PUBLIC]
+//   Return whether the server handle of the connection is still usable. Only
+// the status recorded by the client is checked (no round trip is made), so a
+// connection that was lost without the client noticing is still reported as
+// healthy.
+//-----------------------------------------------------------------------------
+int dpiConn_getIsHealthy(dpiConn *conn, int *isHealthy)
+{
+    uint32_t serverStatus;
+    dpiError error;
+
+    if (dpiConn__checkConnected(conn, __func__, &error) < 0)
+        return DPI_FAILURE;
+    DPI_CHECK_PTR_NOT_NULL(isHealthy)
+    if (dpiOci__attrGet(conn->serverHandle, DPI_OCI_HTYPE_SERVER,
+            &serverStatus, NULL, DPI_OCI_ATTR_SERVER_STATUS,
+            "get server status", &error) < 0)
+        return DPI_FAILURE;
+    *isHealthy = (serverStatus == DPI_OCI_SERVER_NORMAL);
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiConn_getLTXID() [PUBLIC]
 //   Return the logical transaction id associated with the connection.
@@ -1334,13 +1461,15 @@ int dpiConn_newEnqOptions(dpiConn *conn, dpiEnqOptions **options)
 
 //-----------------------------------------------------------------------------
 // dpiConn_newTempLob() [PUBLIC]
-//   Create a new temporary LOB and return it.
+//   Create a new temporary LOB and return it. A temporary LOB reused from
+// those kept by the connection is emptied first.
 //-----------------------------------------------------------------------------
 int dpiConn_newTempLob(dpiConn *conn, dpiOracleTypeNum lobType, dpiLob **lob)
 {
     const dpiOracleType *type;
     dpiLob *tempLob;
     dpiError error;
+    int reused;
 
     if (dpiConn__checkConnected(conn, __func__, &error) < 0)
         return DPI_FAILURE;
@@ -1357,7 +1486,8 @@ int dpiConn_newTempLob(dpiConn *conn, dpiOracleTypeNum lobType, dpiLob **lob)
     }
     if (dpiLob__allocate(conn, type, &tempLob, &error) < 0)
         return DPI_FAILURE;
-    if (dpiOci__lobCreateTemporary(tempLob, &error) < 0) {
+    if (dpiLob__createTemporary(tempLob, &reused, &error) < 0 ||
+            (reused && dpiOci__lobTrim2(tempLob, 0, &error) < 0)) {
         dpiLob__free(tempLob, &error);
         return DPI_FAILURE;
     }
@@ -1455,6 +1585,55 @@ int dpiConn_ping(dpiConn *conn)
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiConn_pingWithTimeout() [PUBLIC]
+//   Same as dpiConn_ping() but the wait for the reply from the server is
+// limited to the given number of milliseconds, as is done when a session
+// acquired from a pool is pinged. The original network timeouts are restored
+// afterwards.
+//-----------------------------------------------------------------------------
+int dpiConn_pingWithTimeout(dpiConn *conn, uint32_t timeout)
+{
+    uint8_t savedBreakOnTimeout, breakOnTimeout;
+    uint32_t savedTimeout;
+    dpiError error;
+    int status;
+
+    if (dpiConn__checkConnected(conn, __func__, &error) < 0)
+        return DPI_FAILURE;
+    if (dpiOci__attrGet(conn->serverHandle, DPI_OCI_HTYPE_SERVER,
+            &savedTimeout, NULL, DPI_OCI_ATTR_RECEIVE_TIMEOUT,
+            "get receive timeout", &error) < 0)
+        return DPI_FAILURE;
+    if (dpiOci__attrSet(conn->serverHandle, DPI_OCI_HTYPE_SERVER, &timeout, 0,
+            DPI_OCI_ATTR_RECEIVE_TIMEOUT, "set receive timeout", &error) < 0)
+        return DPI_FAILURE;
+    if (conn->env->versionInfo->versionNum >= 12) {
+        dpiOci__attrGet(conn->serverHandle, DPI_OCI_HTYPE_SERVER,
+                &savedBreakOnTimeout, NULL, DPI_OCI_ATTR_BREAK_ON_NET_TIMEOUT,
+                NULL, &error);
+        breakOnTimeout = 0;
+        dpiOci__attrSet(conn->serverHandle, DPI_OCI_HTYPE_SERVER,
+                &breakOnTimeout, 0, DPI_OCI_ATTR_BREAK_ON_NET_TIMEOUT, NULL,
+                &error);
+    }
+
+    status = dpiOci__ping(conn, &error);
+
+    // if the ping failed the session is unusable and is going to be dropped,
+    // so the original timeouts only need to be restored on success
+    if (status == 0) {
+        dpiOci__attrSet(conn->serverHandle, DPI_OCI_HTYPE_SERVER,
+                &savedTimeout, 0, DPI_OCI_ATTR_RECEIVE_TIMEOUT, NULL, &error);
+        if (conn->env->versionInfo->versionNum >= 12)
+            dpiOci__attrSet(conn->serverHandle, DPI_OCI_HTYPE_SERVER,
+                    &savedBreakOnTimeout, 0,
+                    DPI_OCI_ATTR_BREAK_ON_NET_TIMEOUT, NULL, &error);
+    }
+    return status;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiConn_prepareDistribTrans() [PUBLIC]
 //   Prepare a distributed transaction for commit. A boolean is returned
@@ -1604,6 +1783,23 @@ int dpiConn_setExternalName(dpiConn *conn, const char *value,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiConn_setInlineLobSize() [PUBLIC]
+//   Set the default size (in bytes) of the first piece of LOB values fetched
+// inline by statements subsequently created with the connection. Values of
+// any length are fetched in full; see dpiStmt_setInlineLobSize().
+//-----------------------------------------------------------------------------
+int dpiConn_setInlineLobSize(dpiConn *conn, uint32_t maxSize)
+{
+    dpiError error;
+
+    if (dpiConn__checkConnected(conn, __func__, &error) < 0)
+        return DPI_FAILURE;
+    conn->inlineLobSize = maxSize;
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiConn_setInternalName() [PUBLIC]
 //   Set the internal name associated with the connection.
@@ -1627,6 +1823,40 @@ int dpiConn_setModule(dpiConn *conn, const char *value, uint32_t valueLength)
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiConn_setPrefetchMemory() [PUBLIC]
+//   Set the default amount of memory (in bytes) used for prefetching rows by
+// statements subsequently created with the connection.
+//-----------------------------------------------------------------------------
+int dpiConn_setPrefetchMemory(dpiConn *conn, uint32_t numBytes)
+{
+    dpiError error;
+
+    if (dpiConn__checkConnected(conn, __func__, &error) < 0)
+        return DPI_FAILURE;
+    conn->prefetchMemory = numBytes;
+    conn->hasPrefetchMemory = 1;
+    return DPI_SUCCESS;
+}
+
+
+//-----------------------------------------------------------------------------
+// dpiConn_setPrefetchRows() [PUBLIC]
+//   Set the default number of rows prefetched by statements subsequently
+// created with the connection, in place of the fetch array size.
+//-----------------------------------------------------------------------------
+int dpiConn_setPrefetchRows(dpiConn *conn, uint32_t numRows)
+{
+    dpiError error;
+
+    if (dpiConn__checkConnected(conn, __func__, &error) < 0)
+        return DPI_FAILURE;
+    conn->prefetchRows = numRows;
+    conn->hasPrefetchRows = 1;
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiConn_setStmtCacheSize() [PUBLIC]
 //   Set the size of the statement cache.
@@ -0,0 +1,836 @@
+// dpiConnPool_nif.c
+// Conexões já abertas guardadas do lado do NIF, na frente do dpiPool. Cada
+// scheduler tem a sua partição (shard) de conexões livres; o checkout e o
+// checkin são uma única troca atômica numa posição do shard, sem mutex e sem
+// passar pelo pool de sessões do OCI. Quando o shard do scheduler está
+// vazio, as conexões livres dos outros shards são usadas; só quando não há
+// nenhuma livre uma nova conexão é obtida do dpiPool, num dirty scheduler.
+// Uma thread de manutenção repõe periodicamente as conexões livres até
+// min_idle, para que o pool já comece com sessões abertas, e verifica as
+// conexões livres: testa (ping) as que estão sem uso há mais de
+// DPI_DEFAULT_PING_INTERVAL segundos e descarta as que falharam ou passaram
+// do tempo de vida máximo do dpiPool. Assim o checkout nunca faz ping. Como
+// uma conexão muito usada nunca fica tanto tempo livre, o checkin consulta o
+// estado do servidor guardado pelo OCI (sem ida ao banco) e descarta a
+// sessão que perdeu a conexão; o ping de todas as livres vem em seguida.
+// Conexões devolvidas com uma tag (que identifica o estado da sessão: NLS,
+// módulo, edição...) não vão para os shards e sim para um índice tag ->
+// conexões livres, protegido por um mutex; o checkout com tag encontra ali
+// uma sessão já no estado pedido sem ir ao OCI e sem ALTER SESSION.
+// Nada que vá ao banco roda num scheduler normal: o checkin que encontra os
+// shards cheios continua num dirty scheduler, as conexões abandonadas (sem
+// checkin) são devolvidas pela thread de manutenção e o pool é desmontado
+// pela thread de limpeza.
+
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "dpiConnPool_nif.h"
+#include "dpiCleanup_nif.h"
+#include "dpiPool_nif.h"
+
+// intervalo entre as rodadas da manutenção e passo com que a thread verifica
+// se deve terminar, em milissegundos
+#define CONN_POOL_MAINTAIN_INTERVAL 1000
+#define CONN_POOL_MAINTAIN_TICK 100
+
+// a verificação das conexões livres é feita a cada tantas rodadas
+#define CONN_POOL_HEALTH_ROUNDS 10
+
+// número de listas do índice de tags
+#define CONN_POOL_TAG_BUCKETS 64
+
+typedef struct conn_pool_entry {
+  dpiConn *conn;
+  ErlNifTime created;
+  ErlNifTime lastUsed;
+  char *tag;
+  uint32_t tagLength;
+  int broken;
+  struct conn_pool_entry *next;
+} conn_pool_entry;
+
+typedef _Atomic(conn_pool_entry*) conn_pool_slot;
+
+typedef struct conn_pool_resource conn_pool_resource;
+
+// Estado do pool; fica fora do recurso porque a thread de manutenção ainda
+// pode estar rodando quando o recurso é destruído.
+typedef struct conn_pool {
+  conn_pool_resource *resource;
+  pool_resource *base;
+  unsigned numShards;
+  unsigned shardSize;
+  conn_pool_slot *slots;
+  unsigned minIdle;
+  unsigned nextFillShard;
+  ErlNifTid maintainer;
+  int maintainerStarted;
+  atomic_int stopping;
+  atomic_int pingAll;
+  ErlNifMutex *tagLock;
+  conn_pool_entry *tagBuckets[CONN_POOL_TAG_BUCKETS];
+  unsigned numTagged;
+  ErlNifMutex *abandonedLock;
+  conn_pool_entry *abandoned;
+} conn_pool;
+
+// Recurso Erlang do pool; cada conexão em uso guarda uma referência a ele.
+struct conn_pool_resource {
+  conn_pool *pool;
+};
+
+static ErlNifResourceType *conn_pool_type;
+static ERL_NIF_TERM atom_ok;
+static ERL_NIF_TERM atom_true;
+static ERL_NIF_TERM atom_false;
+
+// shard de cada thread (scheduler), atribuído no primeiro uso
+static _Thread_local int conn_pool_thread_shard = -1;
+static atomic_uint conn_pool_next_shard;
+
+
+static conn_pool_entry *conn_pool_alloc_entry(dpiConn *conn)
+{
+  conn_pool_entry *entry;
+
+  entry = enif_alloc(sizeof(conn_pool_entry));
+  if (!entry)
+    return NULL;
+  memset(entry, 0, sizeof(conn_pool_entry));
+  entry->conn = conn;
+  entry->created = enif_monotonic_time(ERL_NIF_SEC);
+  entry->lastUsed = entry->created;
+  return entry;
+}
+
+
+static void conn_pool_clear_tag(conn_pool_entry *entry)
+{
+  if (entry->tag)
+    enif_free(entry->tag);
+  entry->tag = NULL;
+  entry->tagLength = 0;
+}
+
+
+// Devolve a conexão ao dpiPool; se tiver tag, ela é mantida na sessão para
+// que o próprio OCI ainda possa encontrá-la por tag.
+static void conn_pool_release_entry(conn_pool_entry *entry)
+{
+  if (entry->tag)
+    dpiConn_close(entry->conn, DPI_MODE_CONN_CLOSE_RETAG, entry->tag,
+        entry->tagLength);
+  dpiConn_release(entry->conn);
+  conn_pool_clear_tag(entry);
+  enif_free(entry);
+}
+
+
+// Descarta a sessão (não volta para o dpiPool).
+static void conn_pool_evict_entry(conn_pool_entry *entry)
+{
+  dpiConn_close(entry->conn, DPI_MODE_CONN_CLOSE_DROP, NULL, 0);
+  dpiConn_release(entry->conn);
+  conn_pool_clear_tag(entry);
+  enif_free(entry);
+}
+
+
+// Devolve ao dpiPool as conexões abandonadas e descarta as que perderam a
+// conexão com o servidor.
+static void conn_pool_release_abandoned(conn_pool *pool)
+{
+  conn_pool_entry *entry, *next;
+
+  enif_mutex_lock(pool->abandonedLock);
+  entry = pool->abandoned;
+  pool->abandoned = NULL;
+  enif_mutex_unlock(pool->abandonedLock);
+  for (; entry; entry = next) {
+    next = entry->next;
+    if (entry->broken)
+      conn_pool_evict_entry(entry);
+    else
+      conn_pool_release_entry(entry);
+  }
+}
+
+
+// Executada pela thread de limpeza (ou direto, se a thread de manutenção
+// não chegou a ser criada): espera a manutenção terminar e devolve todas as
+// conexões livres ao dpiPool.
+static void conn_pool_free(void *arg)
+{
+  conn_pool *pool = arg;
+  conn_pool_entry *entry;
+  unsigned i;
+
+  if (pool->maintainerStarted) {
+    atomic_store(&pool->stopping, 1);
+    enif_thread_join(pool->maintainer, NULL);
+  }
+  if (pool->slots) {
+    for (i = 0; i < pool->numShards * pool->shardSize; i++) {
+      entry = atomic_exchange(&pool->slots[i], NULL);
+      if (entry)
+        conn_pool_release_entry(entry);
+    }
+    enif_free(pool->slots);
+  }
+  for (i = 0; i < CONN_POOL_TAG_BUCKETS; i++) {
+    while ((entry = pool->tagBuckets[i]) != NULL) {
+      pool->tagBuckets[i] = entry->next;
+      conn_pool_release_entry(entry);
+    }
+  }
+  if (pool->abandonedLock) {
+    conn_pool_release_abandoned(pool);
+    enif_mutex_destroy(pool->abandonedLock);
+  }
+  if (pool->tagLock)
+    enif_mutex_destroy(pool->tagLock);
+  if (pool->base)
+    enif_release_resource(pool->base);
+  enif_free(pool);
+}
+
+
+static void conn_pool_dtor(ErlNifEnv *env, void *obj)
+{
+  conn_pool_resource *res = obj;
+
+  if (res->pool) {
+    atomic_store(&res->pool->stopping, 1);
+    cleanup_schedule(conn_pool_free, res->pool);
+  }
+}
+
+
+static int conn_pool_get(ErlNifEnv *env, ERL_NIF_TERM term, conn_pool **pool)
+{
+  conn_pool_resource *res;
+
+  if (!enif_get_resource(env, term, conn_pool_type, (void**) &res))
+    return 0;
+  *pool = res->pool;
+  return 1;
+}
+
+
+int conn_pool_load(ErlNifEnv *env)
+{
+  conn_pool_type = enif_open_resource_type(env, NULL, "oracle_nif_conn_pool",
+      conn_pool_dtor, ERL_NIF_RT_CREATE, NULL);
+  if (!conn_pool_type)
+    return -1;
+  atom_ok = enif_make_atom(env, "ok");
+  atom_true = enif_make_atom(env, "true");
+  atom_false = enif_make_atom(env, "false");
+  return 0;
+}
+
+
+static unsigned conn_pool_home_shard(conn_pool *pool)
+{
+  if (conn_pool_thread_shard < 0)
+    conn_pool_thread_shard = atomic_fetch_add(&conn_pool_next_shard, 1);
+  return conn_pool_thread_shard % pool->numShards;
+}
+
+
+// Pega uma conexão livre, começando pelo shard da thread.
+static conn_pool_entry *conn_pool_take(conn_pool *pool)
+{
+  unsigned i, shard, home;
+  conn_pool_slot *slots;
+  conn_pool_entry *entry;
+
+  home = conn_pool_home_shard(pool);
+  for (shard = 0; shard < pool->numShards; shard++) {
+    slots = &pool->slots[((home + shard) % pool->numShards) *
+        pool->shardSize];
+    for (i = 0; i < pool->shardSize; i++) {
+      if (atomic_load_explicit(&slots[i], memory_order_relaxed) &&
+          (entry = atomic_exchange(&slots[i], NULL)) != NULL)
+        return entry;
+    }
+  }
+  return NULL;
+}
+
+
+// Guarda a conexão numa posição vazia, começando pelo shard home; retorna
+// 0 se todas estiverem ocupadas.
+static int conn_pool_try_put_from(conn_pool *pool, unsigned home,
+    conn_pool_entry *entry)
+{
+  unsigned i, shard;
+  conn_pool_entry *empty;
+  conn_pool_slot *slots;
+
+  for (shard = 0; shard < pool->numShards; shard++) {
+    slots = &pool->slots[((home + shard) % pool->numShards) *
+        pool->shardSize];
+    for (i = 0; i < pool->shardSize; i++) {
+      empty = NULL;
+      if (!atomic_load_explicit(&slots[i], memory_order_relaxed) &&
+          atomic_compare_exchange_strong(&slots[i], &empty, entry))
+        return 1;
+    }
+  }
+  return 0;
+}
+
+
+// Como conn_pool_try_put_from, mas com os shards cheios a conexão volta
+// para o dpiPool; só para a thread de manutenção.
+static void conn_pool_put_from(conn_pool *pool, unsigned home,
+    conn_pool_entry *entry)
+{
+  if (!conn_pool_try_put_from(pool, home, entry))
+    conn_pool_release_entry(entry);
+}
+
+
+// Entrega a conexão à thread de manutenção, que a devolve ao dpiPool; usado
+// nos schedulers normais, onde não se pode ir ao banco.
+static void conn_pool_abandon(conn_pool *pool, conn_pool_entry *entry)
+{
+  enif_mutex_lock(pool->abandonedLock);
+  entry->next = pool->abandoned;
+  pool->abandoned = entry;
+  enif_mutex_unlock(pool->abandonedLock);
+}
+
+
+static unsigned conn_pool_tag_bucket(const char *tag, uint32_t tagLength)
+{
+  uint32_t i, hash = 2166136261u;
+
+  for (i = 0; i < tagLength; i++)
+    hash = (hash ^ (unsigned char) tag[i]) * 16777619u;
+  return hash % CONN_POOL_TAG_BUCKETS;
+}
+
+
+// Tira do índice uma conexão livre com a tag pedida; a tag da entrada é
+// descartada, pois quem faz o checkout pode mudar o estado da sessão.
+static conn_pool_entry *conn_pool_take_tagged(conn_pool *pool,
+    const char *tag, uint32_t tagLength)
+{
+  conn_pool_entry **link, *entry = NULL;
+
+  enif_mutex_lock(pool->tagLock);
+  if (pool->numTagged > 0) {
+    link = &pool->tagBuckets[conn_pool_tag_bucket(tag, tagLength)];
+    for (; *link; link = &(*link)->next) {
+      if ((*link)->tagLength == tagLength &&
+          memcmp((*link)->tag, tag, tagLength) == 0) {
+        entry = *link;
+        *link = entry->next;
+        pool->numTagged--;
+        break;
+      }
+    }
+  }
+  enif_mutex_unlock(pool->tagLock);
+  if (entry)
+    conn_pool_clear_tag(entry);
+  return entry;
+}
+
+
+// Tira do índice uma conexão livre com qualquer tag.
+static conn_pool_entry *conn_pool_take_any_tagged(conn_pool *pool)
+{
+  conn_pool_entry *entry = NULL;
+  unsigned i;
+
+  enif_mutex_lock(pool->tagLock);
+  for (i = 0; i < CONN_POOL_TAG_BUCKETS && pool->numTagged > 0; i++) {
+    entry = pool->tagBuckets[i];
+    if (entry) {
+      pool->tagBuckets[i] = entry->next;
+      pool->numTagged--;
+      break;
+    }
+  }
+  enif_mutex_unlock(pool->tagLock);
+  if (entry)
+    conn_pool_clear_tag(entry);
+  return entry;
+}
+
+
+// Põe no índice de tags uma conexão livre com tag.
+static void conn_pool_put_tagged(conn_pool *pool, conn_pool_entry *entry)
+{
+  unsigned bucket;
+
+  bucket = conn_pool_tag_bucket(entry->tag, entry->tagLength);
+  enif_mutex_lock(pool->tagLock);
+  entry->next = pool->tagBuckets[bucket];
+  pool->tagBuckets[bucket] = entry;
+  pool->numTagged++;
+  enif_mutex_unlock(pool->tagLock);
+}
+
+
+// Devolve a conexão livre: com tag vai para o índice, sem tag para os
+// shards (começando pelo shard da thread) e, com eles cheios, para a thread
+// de manutenção.
+static void conn_pool_return(conn_pool *pool, conn_pool_entry *entry)
+{
+  if (entry->tag)
+    conn_pool_put_tagged(pool, entry);
+  else if (!conn_pool_try_put_from(pool, conn_pool_home_shard(pool), entry))
+    conn_pool_abandon(pool, entry);
+}
+
+
+// Conexões livres nos shards e no índice de tags; as com tag também
+// atendem checkouts sem tag e por isso contam para minIdle.
+static unsigned conn_pool_count_idle(conn_pool *pool)
+{
+  unsigned i, count = 0;
+
+  for (i = 0; i < pool->numShards * pool->shardSize; i++) {
+    if (atomic_load_explicit(&pool->slots[i], memory_order_relaxed))
+      count++;
+  }
+  enif_mutex_lock(pool->tagLock);
+  count += pool->numTagged;
+  enif_mutex_unlock(pool->tagLock);
+  return count;
+}
+
+
+// Abre conexões até haver minIdle livres, distribuídas entre os shards; para
+// na primeira falha (pool esgotado ou banco fora do ar) e tenta de novo na
+// próxima rodada.
+static void conn_pool_fill(conn_pool *pool)
+{
+  conn_pool_entry *entry;
+  unsigned idle;
+  dpiConn *conn;
+
+  idle = conn_pool_count_idle(pool);
+  while (idle < pool->minIdle && !atomic_load(&pool->stopping)) {
+    if (dpiPool_acquireConnection(pool->base->pool, NULL, 0, NULL, 0, NULL,
+        &conn) < 0)
+      break;
+    entry = conn_pool_alloc_entry(conn);
+    if (!entry) {
+      dpiConn_release(conn);
+      break;
+    }
+    conn_pool_put_from(pool, pool->nextFillShard++ % pool->numShards, entry);
+    idle++;
+  }
+}
+
+
+static void conn_pool_sleep(unsigned milliseconds)
+{
+#ifdef _WIN32
+  Sleep(milliseconds);
+#else
+  struct timespec ts;
+
+  ts.tv_sec = milliseconds / 1000;
+  ts.tv_nsec = (milliseconds % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+#endif
+}
+
+
+// Verificação de uma conexão livre que está com a thread de manutenção:
+// retorna 1 se ela continua boa, 0 se foi descartada pelo tempo de vida e
+// -1 se foi descartada por falhar no ping.
+static int conn_pool_check_entry(conn_pool_entry *entry, ErlNifTime now,
+    uint32_t maxLifetime, int pingAll)
+{
+  if (maxLifetime > 0 && now - entry->created >= maxLifetime) {
+    conn_pool_evict_entry(entry);
+    return 0;
+  }
+  if (pingAll || now - entry->lastUsed >= DPI_DEFAULT_PING_INTERVAL) {
+    if (dpiConn_pingWithTimeout(entry->conn, DPI_DEFAULT_PING_TIMEOUT) < 0) {
+      conn_pool_evict_entry(entry);
+      return -1;
+    }
+    entry->lastUsed = now;
+  }
+  return 1;
+}
+
+
+static int conn_pool_entry_due(conn_pool_entry *entry, ErlNifTime now,
+    uint32_t maxLifetime, int pingAll)
+{
+  return pingAll || (maxLifetime > 0 && now - entry->created >= maxLifetime) ||
+      now - entry->lastUsed >= DPI_DEFAULT_PING_INTERVAL;
+}
+
+
+// Verifica as conexões livres; retorna o número de pings que falharam. Cada
+// conexão a verificar sai do pool enquanto é testada, de modo que nenhum
+// checkout a recebe nesse meio tempo.
+static unsigned conn_pool_check(conn_pool *pool, int pingAll)
+{
+  conn_pool_entry **link, *entry, *due = NULL;
+  unsigned i, numFailed = 0;
+  uint32_t maxLifetime;
+  ErlNifTime now;
+  int status;
+
+  if (dpiPool_getMaxLifetimeSession(pool->base->pool, &maxLifetime) < 0)
+    maxLifetime = 0;
+  now = enif_monotonic_time(ERL_NIF_SEC);
+
+  for (i = 0; i < pool->numShards * pool->shardSize; i++) {
+    if (atomic_load(&pool->stopping))
+      return numFailed;
+    if (!atomic_load_explicit(&pool->slots[i], memory_order_relaxed))
+      continue;
+    entry = atomic_exchange(&pool->slots[i], NULL);
+    if (!entry)
+      continue;
+    status = conn_pool_check_entry(entry, now, maxLifetime, pingAll);
+    if (status < 0)
+      numFailed++;
+    else if (status > 0)
+      conn_pool_put_from(pool, i / pool->shardSize, entry);
+  }
+
+  // as conexões com tag são separadas do índice sob o mutex e verificadas
+  // fora dele
+  enif_mutex_lock(pool->tagLock);
+  for (i = 0; i < CONN_POOL_TAG_BUCKETS; i++) {
+    for (link = &pool->tagBuckets[i]; *link; ) {
+      entry = *link;
+      if (conn_pool_entry_due(entry, now, maxLifetime, pingAll)) {
+        *link = entry->next;
+        entry->next = due;
+        due = entry;
+        pool->numTagged--;
+      } else {
+        link = &entry->next;
+      }
+    }
+  }
+  enif_mutex_unlock(pool->tagLock);
+  while (due) {
+    entry = due;
+    due = entry->next;
+    status = conn_pool_check_entry(entry, now, maxLifetime, pingAll);
+    if (status < 0)
+      numFailed++;
+    else if (status > 0)
+      conn_pool_return(pool, entry);
+  }
+  return numFailed;
+}
+
+
+// Thread de manutenção; não guarda referência ao recurso: o destrutor do
+// pool a interrompe e a thread de limpeza espera por ela. Uma falha de ping
+// ou uma sessão descartada no checkin costumam indicar queda ou failover do
+// banco, então nesse caso todas as conexões livres são testadas no passo
+// seguinte. As conexões abandonadas são devolvidas ao dpiPool a cada passo.
+static void *conn_pool_maintain(void *arg)
+{
+  conn_pool *pool = arg;
+  unsigned elapsed, round;
+
+  for (round = 1; !atomic_load(&pool->stopping); round++) {
+    if (round % CONN_POOL_HEALTH_ROUNDS == 0 && conn_pool_check(pool, 0) > 0)
+      atomic_store(&pool->pingAll, 1);
+    conn_pool_fill(pool);
+    for (elapsed = 0; elapsed < CONN_POOL_MAINTAIN_INTERVAL &&
+        !atomic_load(&pool->stopping); elapsed += CONN_POOL_MAINTAIN_TICK) {
+      conn_pool_release_abandoned(pool);
+      if (atomic_exchange(&pool->pingAll, 0))
+        conn_pool_check(pool, 1);
+      conn_pool_sleep(CONN_POOL_MAINTAIN_TICK);
+    }
+  }
+  return NULL;
+}
+
+
+// Destrutor da conexão. Se não houve checkin, o estado da sessão é
+// desconhecido, então ela volta para o dpiPool e não para os shards; quem
+// faz isso é a thread de manutenção, pois o destrutor roda num scheduler
+// normal.
+void conn_pool_drop(conn_resource *res)
+{
+  conn_pool_entry *entry;
+
+  entry = atomic_exchange(&res->entry, NULL);
+  if (entry) {
+    conn_pool_clear_tag(entry);
+    conn_pool_abandon(res->pool, entry);
+  }
+  atomic_store(&res->conn, NULL);
+  enif_release_resource(res->pool->resource);
+  res->pool = NULL;
+}
+
+
+// conn_pool_create(pool, min_idle) -> {:ok, conn_pool}; um shard por
+// scheduler, com posições suficientes para todas as sessões do pool
+ERL_NIF_TERM conn_pool_create(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  conn_pool_resource *res;
+  pool_resource *base;
+  ErlNifSysInfo info;
+  ERL_NIF_TERM term;
+  conn_pool *pool;
+  unsigned i, minIdle;
+
+  if (!pool_get_resource(env, argv[0], &base) ||
+      !enif_get_uint(env, argv[1], &minIdle))
+    return enif_make_badarg(env);
+  pool = enif_alloc(sizeof(conn_pool));
+  if (!pool)
+    return enif_make_badarg(env);
+  memset(pool, 0, sizeof(conn_pool));
+  enif_system_info(&info, sizeof(info));
+  pool->numShards = (info.scheduler_threads > 0) ? info.scheduler_threads : 1;
+  pool->shardSize = (base->maxSessions + pool->numShards - 1) /
+      pool->numShards;
+  pool->slots = enif_alloc(pool->numShards * pool->shardSize *
+      sizeof(conn_pool_slot));
+  pool->tagLock = enif_mutex_create("oracle_nif_conn_pool_tags");
+  pool->abandonedLock = enif_mutex_create("oracle_nif_conn_pool_abandoned");
+  if (!pool->slots || !pool->tagLock || !pool->abandonedLock) {
+    conn_pool_free(pool);
+    return enif_make_badarg(env);
+  }
+  for (i = 0; i < pool->numShards * pool->shardSize; i++)
+    atomic_init(&pool->slots[i], NULL);
+  enif_keep_resource(base);
+  pool->base = base;
+  pool->minIdle = (minIdle < base->maxSessions) ? minIdle : base->maxSessions;
+  atomic_init(&pool->stopping, 0);
+  atomic_init(&pool->pingAll, 0);
+
+  res = enif_alloc_resource(conn_pool_type, sizeof(conn_pool_resource));
+  if (!res) {
+    conn_pool_free(pool);
+    return enif_make_badarg(env);
+  }
+  res->pool = NULL;
+  pool->resource = res;
+  if (enif_thread_create("oracle_nif_conn_pool", &pool->maintainer,
+      conn_pool_maintain, pool, NULL) != 0) {
+    enif_release_resource(res);
+    conn_pool_free(pool);
+    return enif_make_badarg(env);
+  }
+  pool->maintainerStarted = 1;
+  res->pool = pool;
+
+  term = enif_make_resource(env, res);
+  enif_release_resource(res);
+  return enif_make_tuple2(env, atom_ok, term);
+}
+
+
+// {:ok, conn} ou, no checkout com tag, {:ok, conn, tag encontrada?}
+static ERL_NIF_TERM conn_pool_wrap(ErlNifEnv *env, conn_pool *pool,
+    conn_pool_entry *entry, int tagged, int matched)
+{
+  conn_resource *res;
+  ERL_NIF_TERM term;
+
+  res = conn_alloc_resource(entry->conn);
+  if (!res) {
+    conn_pool_return(pool, entry);
+    return enif_make_badarg(env);
+  }
+  enif_keep_resource(pool->resource);
+  res->pool = pool;
+  atomic_store(&res->entry, entry);
+  term = enif_make_resource(env, res);
+  enif_release_resource(res);
+  if (tagged)
+    return enif_make_tuple3(env, atom_ok, term,
+        matched ? atom_true : atom_false);
+  return enif_make_tuple2(env, atom_ok, term);
+}
+
+
+// Caminho lento do checkout: nenhuma conexão livre adequada. Com tag, ainda
+// procura no índice e nos shards; com ou sem tag, aceita uma conexão livre
+// com outra tag antes de obter uma sessão do dpiPool, que também faz a busca
+// por tag do OCI. Sem isso, com o dpiPool esgotado, o checkout sem tag
+// esperaria (ou, no modo NOWAIT, falharia) com sessões livres no índice.
+static ERL_NIF_TERM conn_pool_checkout_dirty(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  dpiConnCreateParams params;
+  conn_pool_entry *entry;
+  ErlNifBinary tag;
+  conn_pool *pool;
+  int matched = 0;
+  dpiConn *conn;
+
+  if (!conn_pool_get(env, argv[0], &pool) ||
+      (argc > 1 && !enif_inspect_binary(env, argv[1], &tag)))
+    return enif_make_badarg(env);
+  if (argc > 1) {
+    entry = conn_pool_take_tagged(pool, (const char*) tag.data, tag.size);
+    matched = (entry != NULL);
+    if (!entry)
+      entry = conn_pool_take(pool);
+    if (!entry)
+      entry = conn_pool_take_any_tagged(pool);
+  } else {
+    entry = conn_pool_take(pool);
+    if (!entry)
+      entry = conn_pool_take_any_tagged(pool);
+  }
+  if (!entry) {
+    dpiContext_initConnCreateParams(conn_context(), &params);
+    if (argc > 1) {
+      params.tag = (const char*) tag.data;
+      params.tagLength = tag.size;
+    }
+    if (dpiPool_acquireConnection(pool->base->pool, NULL, 0, NULL, 0,
+        &params, &conn) < 0)
+      return conn_make_error(env);
+    entry = conn_pool_alloc_entry(conn);
+    if (!entry) {
+      dpiConn_release(conn);
+      return enif_make_badarg(env);
+    }
+    matched = params.outTagFound;
+  }
+  return conn_pool_wrap(env, pool, entry, argc > 1, matched);
+}
+
+
+// conn_pool_checkout(conn_pool) -> {:ok, conn} | {:error, msg}
+// conn_pool_checkout(conn_pool, tag) -> {:ok, conn, tag encontrada?} |
+// {:error, msg}; quando a tag não é encontrada, cabe a quem chamou colocar a
+// sessão no estado desejado
+ERL_NIF_TERM conn_pool_checkout(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  conn_pool_entry *entry;
+  ErlNifBinary tag;
+  conn_pool *pool;
+
+  if (!conn_pool_get(env, argv[0], &pool) ||
+      (argc > 1 && !enif_inspect_binary(env, argv[1], &tag)))
+    return enif_make_badarg(env);
+  if (argc > 1) {
+    entry = conn_pool_take_tagged(pool, (const char*) tag.data, tag.size);
+    if (entry)
+      return conn_pool_wrap(env, pool, entry, 1, 1);
+  }
+  entry = conn_pool_take(pool);
+  if (!entry)
+    return enif_schedule_nif(env, "conn_pool_checkout",
+        ERL_NIF_DIRTY_JOB_IO_BOUND, conn_pool_checkout_dirty, argc, argv);
+  return conn_pool_wrap(env, pool, entry, argc > 1, 0);
+}
+
+
+// Tira a entrada da conexão, que deixa de ser utilizável; só um checkin
+// concorrente consegue. Com tag, a entrada a leva para o índice. A sessão
+// cujo servidor o OCI já sabe que caiu é marcada para ser descartada.
+static conn_pool_entry *conn_pool_checkin_entry(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[], conn_resource **res)
+{
+  conn_pool_entry *entry;
+  ErlNifBinary tag;
+  int healthy;
+
+  if (!conn_get_resource(env, argv[0], res) || !(*res)->pool ||
+      atomic_load(&(*res)->busy) ||
+      (argc > 1 && !enif_inspect_binary(env, argv[1], &tag)))
+    return NULL;
+  entry = atomic_exchange(&(*res)->entry, NULL);
+  if (!entry)
+    return NULL;
+  atomic_store(&(*res)->conn, NULL);
+  entry->lastUsed = enif_monotonic_time(ERL_NIF_SEC);
+  if (dpiConn_getIsHealthy(entry->conn, &healthy) < 0 || !healthy) {
+    entry->broken = 1;
+    return entry;
+  }
+  if (argc > 1 && tag.size > 0) {
+    entry->tag = enif_alloc(tag.size);
+    if (entry->tag) {
+      memcpy(entry->tag, tag.data, tag.size);
+      entry->tagLength = tag.size;
+    }
+  }
+  return entry;
+}
+
+
+// A sessão quebrada vai para a thread de manutenção, que a descarta e testa
+// as demais conexões livres.
+static void conn_pool_checkin_broken(conn_pool *pool, conn_pool_entry *entry)
+{
+  conn_pool_abandon(pool, entry);
+  atomic_store(&pool->pingAll, 1);
+}
+
+
+// Checkin com os shards cheios: a sessão volta para o dpiPool aqui, num
+// dirty scheduler.
+static ERL_NIF_TERM conn_pool_checkin_dirty(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  conn_pool_entry *entry;
+  conn_resource *res;
+
+  entry = conn_pool_checkin_entry(env, argc, argv, &res);
+  if (!entry)
+    return enif_make_badarg(env);
+  if (entry->broken)
+    conn_pool_checkin_broken(res->pool, entry);
+  else if (entry->tag)
+    conn_pool_put_tagged(res->pool, entry);
+  else if (!conn_pool_try_put_from(res->pool,
+      conn_pool_home_shard(res->pool), entry))
+    conn_pool_release_entry(entry);
+  return atom_ok;
+}
+
+
+// conn_pool_checkin(conn) -> :ok
+// conn_pool_checkin(conn, tag) -> :ok; a tag descreve o estado em que a
+// sessão foi deixada. Depois do checkin a conexão não pode mais ser usada.
+// A referência ao pool só é solta pelo destrutor da conexão.
+ERL_NIF_TERM conn_pool_checkin(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  conn_pool_entry *entry;
+  conn_resource *res;
+
+  entry = conn_pool_checkin_entry(env, argc, argv, &res);
+  if (!entry)
+    return enif_make_badarg(env);
+  if (entry->broken)
+    conn_pool_checkin_broken(res->pool, entry);
+  else if (entry->tag)
+    conn_pool_put_tagged(res->pool, entry);
+  else if (!conn_pool_try_put_from(res->pool,
+      conn_pool_home_shard(res->pool), entry)) {
+    atomic_store(&res->entry, entry);
+    return enif_schedule_nif(env, "conn_pool_checkin",
+        ERL_NIF_DIRTY_JOB_IO_BOUND, conn_pool_checkin_dirty, argc, argv);
+  }
+  return atom_ok;
+}
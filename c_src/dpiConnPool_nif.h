@@ -0,0 +1,18 @@
+#ifndef DPICONNPOOL_NIF_H
+#define DPICONNPOOL_NIF_H
+
+#include <erl_nif.h>
+#include "dpi.h"
+#include "dpiConn_nif.h"
+
+int conn_pool_load(ErlNifEnv *env);
+void conn_pool_drop(conn_resource *res);
+
+ERL_NIF_TERM conn_pool_create(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM conn_pool_checkout(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM conn_pool_checkin(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+
+#endif
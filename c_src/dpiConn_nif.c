@@ -1,11 +1,175 @@
+// dpiConn_nif.c
+// Conexões com o banco. O dpiContext é único para toda a biblioteca e só é
+// criado na primeira conexão, para que carregar o NIF não dependa do
+// Oracle Client.
+
+#include <string.h>
 #include "dpiConn_nif.h"
+#include "dpiConnPool_nif.h"
 
+static ErlNifResourceType *conn_type;
+static ErlNifMutex *context_lock;
+static dpiContext *context;
+static ERL_NIF_TERM atom_ok;
+static ERL_NIF_TERM atom_error;
 
-ERL_NIF_TERM getConn(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+
+static void conn_dtor(ErlNifEnv *env, void *obj)
+{
+  conn_resource *res = obj;
+
+  dpiConn *conn;
+
+  if (res->pool)
+    conn_pool_drop(res);
+  else if ((conn = atomic_load(&res->conn)) != NULL)
+    dpiConn_release(conn);
+}
+
+
+int conn_load(ErlNifEnv *env)
+{
+  conn_type = enif_open_resource_type(env, NULL, "oracle_nif_conn",
+      conn_dtor, ERL_NIF_RT_CREATE, NULL);
+  context_lock = enif_mutex_create("oracle_nif_context_lock");
+  if (!conn_type || !context_lock)
+    return -1;
+  atom_ok = enif_make_atom(env, "ok");
+  atom_error = enif_make_atom(env, "error");
+  return 0;
+}
+
+
+dpiContext *conn_context(void)
+{
+  return context;
+}
+
+
+int conn_get_resource(ErlNifEnv *env, ERL_NIF_TERM term, conn_resource **res)
+{
+  return enif_get_resource(env, term, conn_type, (void**) res);
+}
+
+
+// Conexão ainda utilizável guardada no termo; falha depois do checkin e
+// enquanto a conexão estiver ocupada.
+int conn_get_conn(ErlNifEnv *env, ERL_NIF_TERM term, dpiConn **conn)
+{
+  conn_resource *res;
+
+  if (!conn_get_resource(env, term, &res) || atomic_load(&res->busy))
+    return 0;
+  *conn = atomic_load(&res->conn);
+  return *conn != NULL;
+}
+
+
+// Recurso para uma conexão; quem chama cria o termo e libera o recurso.
+conn_resource *conn_alloc_resource(dpiConn *conn)
+{
+  conn_resource *res;
+
+  res = enif_alloc_resource(conn_type, sizeof(conn_resource));
+  if (!res)
+    return NULL;
+  memset(res, 0, sizeof(conn_resource));
+  atomic_init(&res->conn, conn);
+  atomic_init(&res->busy, 0);
+  return res;
+}
+
+
+// {:error, mensagem} com o último erro ocorrido nesta thread
+ERL_NIF_TERM conn_make_error(ErlNifEnv *env)
+{
+  dpiErrorInfo info;
+  ERL_NIF_TERM message;
+  unsigned char *ptr;
+
+  dpiContext_getError(context, &info);
+  ptr = enif_make_new_binary(env, info.messageLength, &message);
+  memcpy(ptr, info.message, info.messageLength);
+  return enif_make_tuple2(env, atom_error, message);
+}
+
+
+int conn_create_context(ErlNifEnv *env, ERL_NIF_TERM *error)
 {
+  dpiErrorInfo info;
+  unsigned char *ptr;
+  int status = DPI_SUCCESS;
+
+  enif_mutex_lock(context_lock);
+  if (!context && dpiContext_create(DPI_MAJOR_VERSION, DPI_MINOR_VERSION,
+      &context, &info) < 0) {
+    ptr = enif_make_new_binary(env, info.messageLength, error);
+    memcpy(ptr, info.message, info.messageLength);
+    *error = enif_make_tuple2(env, atom_error, *error);
+    status = DPI_FAILURE;
+  }
+  enif_mutex_unlock(context_lock);
+  return status;
+}
+
+
+// Conexões e pools são usados pelas threads dos dirty schedulers e pelas
+// threads de busca, por isso o ambiente OCI é sempre criado em modo threaded.
+void conn_init_common_params(dpiCommonCreateParams *params)
+{
+  dpiContext_initCommonCreateParams(context, params);
+  params->createMode |= DPI_MODE_CREATE_THREADED;
+}
 
 
+// getConn(usuário, senha, string de conexão) -> {:ok, conn} | {:error, msg}
+ERL_NIF_TERM getConn(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
+{
+  ErlNifBinary user, password, connectString;
+  dpiCommonCreateParams commonParams;
+  conn_resource *res;
+  ERL_NIF_TERM term;
+  dpiConn *conn;
+
+  if (!enif_inspect_binary(env, argv[0], &user) ||
+      !enif_inspect_binary(env, argv[1], &password) ||
+      !enif_inspect_binary(env, argv[2], &connectString))
+    return enif_make_badarg(env);
+  if (conn_create_context(env, &term) < 0)
+    return term;
+  conn_init_common_params(&commonParams);
+  if (dpiConn_create(context, (const char*) user.data, user.size,
+      (const char*) password.data, password.size,
+      (const char*) connectString.data, connectString.size, &commonParams,
+      NULL, &conn) < 0)
+    return conn_make_error(env);
 
+  res = conn_alloc_resource(conn);
+  if (!res) {
+    dpiConn_release(conn);
+    return enif_make_badarg(env);
+  }
+  term = enif_make_resource(env, res);
+  enif_release_resource(res);
+  return enif_make_tuple2(env, atom_ok, term);
 }
 
 
+// conn_set_inline_lob_size(conn, bytes) -> :ok | {:error, msg}
+// CLOBs e BLOBs passam a vir junto com as linhas das próximas consultas
+// (como binários), sem uma ida ao banco por LOB; valores maiores que bytes
+// também vêm, em mais de uma parte. Não há limite: cada valor fica inteiro
+// na memória, por maior que seja. Zero volta a buscar localizadores.
+ERL_NIF_TERM conn_set_inline_lob_size(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  unsigned size;
+  dpiConn *conn;
+
+  if (!conn_get_conn(env, argv[0], &conn) ||
+      !enif_get_uint(env, argv[1], &size))
+    return enif_make_badarg(env);
+  if (dpiConn_setInlineLobSize(conn, size) < 0)
+    return conn_make_error(env);
+  return atom_ok;
+}
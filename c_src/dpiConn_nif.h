@@ -1,4 +1,36 @@
+#ifndef DPICONN_NIF_H
+#define DPICONN_NIF_H
+
+#include <stdatomic.h>
 #include <erl_nif.h>
 #include "dpi.h"
 
-ERL_NIF_TERM getConn(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]);
\ No newline at end of file
+struct conn_pool;
+struct conn_pool_entry;
+
+// Conexão guardada num recurso Erlang; liberada pelo destrutor do recurso.
+// Conexões obtidas de um conn_pool guardam o pool e a entrada para onde
+// voltam no checkin; o checkin zera conn, que por isso é atômico e deve ser
+// lido uma única vez (conn_get_conn). Enquanto busy estiver marcado (escrita
+// de LOB por partes em aberto), conn_get_conn e o checkin recusam a conexão.
+typedef struct {
+  _Atomic(dpiConn*) conn;
+  atomic_int busy;
+  struct conn_pool *pool;
+  _Atomic(struct conn_pool_entry*) entry;
+} conn_resource;
+
+int conn_load(ErlNifEnv *env);
+dpiContext *conn_context(void);
+int conn_create_context(ErlNifEnv *env, ERL_NIF_TERM *error);
+void conn_init_common_params(dpiCommonCreateParams *params);
+int conn_get_resource(ErlNifEnv *env, ERL_NIF_TERM term, conn_resource **res);
+int conn_get_conn(ErlNifEnv *env, ERL_NIF_TERM term, dpiConn **conn);
+conn_resource *conn_alloc_resource(dpiConn *conn);
+ERL_NIF_TERM conn_make_error(ErlNifEnv *env);
+
+ERL_NIF_TERM getConn(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM conn_set_inline_lob_size(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+
+#endif
@@ -0,0 +1,259 @@
+// dpiData_nif.c
+// Conversão dos valores buscados (dpiData) em termos Erlang. A função de
+// conversão de cada coluna é escolhida uma única vez a partir do
+// dpiStmt_getQueryInfo, evitando um switch por valor. Os conversores só
+// recebem valores não nulos: os nulos são resolvidos pelo bitmap de nulos da
+// coluna em data_encode_rows.
+
+#include <string.h>
+#include "dpiData_nif.h"
+
+static ERL_NIF_TERM atom_nil;
+static ERL_NIF_TERM atom_true;
+static ERL_NIF_TERM atom_false;
+static ERL_NIF_TERM atom_unsupported;
+
+
+int data_load(ErlNifEnv *env)
+{
+  atom_nil = enif_make_atom(env, "nil");
+  atom_true = enif_make_atom(env, "true");
+  atom_false = enif_make_atom(env, "false");
+  atom_unsupported = enif_make_atom(env, "unsupported");
+  return 0;
+}
+
+
+static ERL_NIF_TERM encode_int64(ErlNifEnv *env, dpiData *data)
+{
+  return enif_make_int64(env, data->value.asInt64);
+}
+
+static ERL_NIF_TERM encode_uint64(ErlNifEnv *env, dpiData *data)
+{
+  return enif_make_uint64(env, data->value.asUint64);
+}
+
+static ERL_NIF_TERM encode_double(ErlNifEnv *env, dpiData *data)
+{
+  return enif_make_double(env, data->value.asDouble);
+}
+
+static ERL_NIF_TERM encode_float(ErlNifEnv *env, dpiData *data)
+{
+  return enif_make_double(env, data->value.asFloat);
+}
+
+static ERL_NIF_TERM encode_boolean(ErlNifEnv *env, dpiData *data)
+{
+  return data->value.asBoolean ? atom_true : atom_false;
+}
+
+// textos, RAW e NUMBER buscado como texto viram binários
+static ERL_NIF_TERM encode_bytes(ErlNifEnv *env, dpiData *data)
+{
+  ERL_NIF_TERM term;
+  unsigned char *ptr;
+
+  ptr = enif_make_new_binary(env, data->value.asBytes.length, &term);
+  if (data->value.asBytes.length > 0)
+    memcpy(ptr, data->value.asBytes.ptr, data->value.asBytes.length);
+  return term;
+}
+
+// DATE -> {{ano, mês, dia}, {hora, minuto, segundo}}
+static ERL_NIF_TERM encode_date(ErlNifEnv *env, dpiData *data)
+{
+  dpiTimestamp *ts = &data->value.asTimestamp;
+
+  return enif_make_tuple2(env,
+      enif_make_tuple3(env, enif_make_int(env, ts->year),
+          enif_make_int(env, ts->month), enif_make_int(env, ts->day)),
+      enif_make_tuple3(env, enif_make_int(env, ts->hour),
+          enif_make_int(env, ts->minute), enif_make_int(env, ts->second)));
+}
+
+// TIMESTAMP -> {{ano, mês, dia}, {hora, minuto, segundo, microssegundo}}
+static ERL_NIF_TERM encode_timestamp(ErlNifEnv *env, dpiData *data)
+{
+  dpiTimestamp *ts = &data->value.asTimestamp;
+
+  return enif_make_tuple2(env,
+      enif_make_tuple3(env, enif_make_int(env, ts->year),
+          enif_make_int(env, ts->month), enif_make_int(env, ts->day)),
+      enif_make_tuple4(env, enif_make_int(env, ts->hour),
+          enif_make_int(env, ts->minute), enif_make_int(env, ts->second),
+          enif_make_uint(env, ts->fsecond / 1000)));
+}
+
+static ERL_NIF_TERM encode_unsupported(ErlNifEnv *env, dpiData *data)
+{
+  return atom_unsupported;
+}
+
+
+static data_encoder encoder_for(dpiQueryInfo *info)
+{
+  switch (info->defaultNativeTypeNum) {
+    case DPI_NATIVE_TYPE_INT64:
+      return encode_int64;
+    case DPI_NATIVE_TYPE_UINT64:
+      return encode_uint64;
+    case DPI_NATIVE_TYPE_DOUBLE:
+      return encode_double;
+    case DPI_NATIVE_TYPE_FLOAT:
+      return encode_float;
+    case DPI_NATIVE_TYPE_BOOLEAN:
+      return encode_boolean;
+    case DPI_NATIVE_TYPE_BYTES:
+      return encode_bytes;
+    case DPI_NATIVE_TYPE_TIMESTAMP:
+      if (info->oracleTypeNum == DPI_ORACLE_TYPE_DATE)
+        return encode_date;
+      return encode_timestamp;
+    default:
+      return encode_unsupported;
+  }
+}
+
+
+// Monta a tabela de conversores, uma entrada por coluna da consulta.
+int data_encoders_create(dpiStmt *stmt, uint32_t numColumns,
+    data_encoder **encoders)
+{
+  dpiQueryInfo info;
+  data_encoder *table;
+  uint32_t i;
+
+  table = enif_alloc(numColumns * sizeof(data_encoder) + 1);
+  if (!table)
+    return DPI_FAILURE;
+  for (i = 0; i < numColumns; i++) {
+    if (dpiStmt_getQueryInfo(stmt, i + 1, &info) < 0) {
+      enif_free(table);
+      return DPI_FAILURE;
+    }
+    table[i] = encoder_for(&info);
+  }
+  *encoders = table;
+  return DPI_SUCCESS;
+}
+
+
+void data_encoders_free(data_encoder *encoders)
+{
+  if (encoders)
+    enif_free(encoders);
+}
+
+
+// Converte as numRows linhas retornadas pelo último dpiStmt_fetchRows
+// (a partir de bufferRowIndex) em uma lista de linhas, cada linha uma lista
+// de valores. Os valores de cada coluna são contíguos: dpiStmt_getQueryValue
+// aponta para a última linha do bloco, então a primeira está numRows - 1
+// posições antes. A conversão é feita coluna a coluna, sempre com o mesmo
+// conversor, e os nulos vêm do bitmap da coluna: sem nulos no bloco, ou num
+// trecho de 64 linhas com a palavra zerada, os valores são convertidos sem
+// nenhum teste por linha; trechos só com NULL são preenchidos de uma vez.
+int data_encode_rows(ErlNifEnv *env, dpiStmt *stmt, uint32_t numColumns,
+    data_encoder *encoders, uint32_t bufferRowIndex, uint32_t numRows,
+    ERL_NIF_TERM *rows)
+{
+  dpiNativeTypeNum nativeTypeNum;
+  ERL_NIF_TERM *cells, list;
+  const uint64_t *nulls;
+  data_encoder encoder;
+  uint32_t i, j, k, row, numNulls;
+  dpiData *values;
+  uint64_t word;
+
+  *rows = enif_make_list(env, 0);
+  if (numRows == 0)
+    return DPI_SUCCESS;
+  cells = enif_alloc(numRows * numColumns * sizeof(ERL_NIF_TERM) + 1);
+  if (!cells)
+    return DPI_FAILURE;
+
+  for (j = 0; j < numColumns; j++) {
+    if (dpiStmt_getQueryValue(stmt, j + 1, &nativeTypeNum, &values) < 0) {
+      enif_free(cells);
+      return DPI_FAILURE;
+    }
+    if (dpiStmt_getQueryNullBitmap(stmt, j + 1, &nulls, &numNulls) < 0) {
+      enif_free(cells);
+      return DPI_FAILURE;
+    }
+    values -= numRows - 1;
+    encoder = encoders[j];
+    if (numNulls == 0) {
+      for (i = 0; i < numRows; i++)
+        cells[i * numColumns + j] = encoder(env, &values[i]);
+      continue;
+    }
+    for (i = 0; i < numRows; i++) {
+      row = bufferRowIndex + i;
+      word = nulls[row / 64];
+      if (row % 64 == 0 && i + 64 <= numRows && word == 0) {
+        for (k = 0; k < 64; k++)
+          cells[(i + k) * numColumns + j] = encoder(env, &values[i + k]);
+        i += 63;
+      } else if (row % 64 == 0 && i + 64 <= numRows &&
+          word == ~(uint64_t) 0) {
+        for (k = 0; k < 64; k++)
+          cells[(i + k) * numColumns + j] = atom_nil;
+        i += 63;
+      } else if ((word >> (row % 64)) & 1) {
+        cells[i * numColumns + j] = atom_nil;
+      } else {
+        cells[i * numColumns + j] = encoder(env, &values[i]);
+      }
+    }
+  }
+
+  list = *rows;
+  for (i = numRows; i > 0; i--)
+    list = enif_make_list_cell(env, enif_make_list_from_array(env,
+        &cells[(i - 1) * numColumns], numColumns), list);
+  *rows = list;
+  enif_free(cells);
+  return DPI_SUCCESS;
+}
+
+
+// Busca todas as linhas que faltam da consulta, fetchArraySize por vez, e
+// devolve uma única lista de linhas.
+int data_fetch_all(ErlNifEnv *env, dpiStmt *stmt, uint32_t numColumns,
+    uint32_t fetchArraySize, ERL_NIF_TERM *rows)
+{
+  uint32_t bufferRowIndex, numRows, count = 0, allocated = 0;
+  ERL_NIF_TERM block, head, *cells = NULL, *temp;
+  data_encoder *encoders;
+  int moreRows, status = DPI_FAILURE;
+
+  if (data_encoders_create(stmt, numColumns, &encoders) < 0)
+    return DPI_FAILURE;
+  do {
+    if (dpiStmt_fetchRows(stmt, fetchArraySize, &bufferRowIndex, &numRows,
+        &moreRows) < 0 ||
+        data_encode_rows(env, stmt, numColumns, encoders, bufferRowIndex,
+            numRows, &block) < 0)
+      goto done;
+    if (count + numRows > allocated) {
+      allocated = (count + numRows) * 2;
+      temp = enif_realloc(cells, allocated * sizeof(ERL_NIF_TERM));
+      if (!temp)
+        goto done;
+      cells = temp;
+    }
+    while (enif_get_list_cell(env, block, &head, &block))
+      cells[count++] = head;
+  } while (moreRows);
+  *rows = enif_make_list_from_array(env, cells, count);
+  status = DPI_SUCCESS;
+
+done:
+  if (cells)
+    enif_free(cells);
+  data_encoders_free(encoders);
+  return status;
+}
@@ -0,0 +1,20 @@
+#ifndef DPIDATA_NIF_H
+#define DPIDATA_NIF_H
+
+#include <erl_nif.h>
+#include "dpi.h"
+
+// Converte um valor (dpiData) de uma coluna em um termo Erlang.
+typedef ERL_NIF_TERM (*data_encoder)(ErlNifEnv *env, dpiData *data);
+
+int data_load(ErlNifEnv *env);
+int data_encoders_create(dpiStmt *stmt, uint32_t numColumns,
+    data_encoder **encoders);
+void data_encoders_free(data_encoder *encoders);
+int data_encode_rows(ErlNifEnv *env, dpiStmt *stmt, uint32_t numColumns,
+    data_encoder *encoders, uint32_t bufferRowIndex, uint32_t numRows,
+    ERL_NIF_TERM *rows);
+int data_fetch_all(ErlNifEnv *env, dpiStmt *stmt, uint32_t numColumns,
+    uint32_t fetchArraySize, ERL_NIF_TERM *rows);
+
+#endif
@@ -245,8 +245,10 @@ int dpiEnv__init(dpiEnv *env, const dpiContext *context,
             &env->ncharsetId, env->nencoding, error) < 0)
         return DPI_FAILURE;
 
-    // acquire max bytes per character
-    if (dpiOci__nlsNumericInfoGet(env, &env->maxBytesPerCharacter,
+    // acquire max bytes per character; this is fixed for AL32UTF8
+    if (env->charsetId == DPI_CHARSET_ID_UTF8)
+        env->maxBytesPerCharacter = DPI_CHARSET_UTF8_MAX_BYTES_PER_CHAR;
+    else if (dpiOci__nlsNumericInfoGet(env, &env->maxBytesPerCharacter,
             DPI_OCI_NLS_CHARSET_MAXBYTESZ, error) < 0)
         return DPI_FAILURE;
 
@@ -262,8 +264,12 @@ int dpiEnv__init(dpiEnv *env, const dpiContext *context,
             error) < 0)
         return DPI_FAILURE;
 
-    // populate base date with January 1, 1970
-    if (dpiOci__nlsCharSetConvert(env, env->charsetId, timezoneBuffer,
+    // populate base date with January 1, 1970; AL32UTF8 is a superset of
+    // ASCII so no conversion of the time zone is required in that case
+    if (env->charsetId == DPI_CHARSET_ID_UTF8) {
+        timezoneLength = 6;
+        memcpy(timezoneBuffer, "+00:00", timezoneLength);
+    } else if (dpiOci__nlsCharSetConvert(env, env->charsetId, timezoneBuffer,
             sizeof(timezoneBuffer), DPI_CHARSET_ID_ASCII, "+00:00", 6,
             &timezoneLength, error) < 0)
         return DPI_FAILURE;
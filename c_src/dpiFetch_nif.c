@@ -0,0 +1,185 @@
+// dpiFetch_nif.c
+// Busca em pipeline. A thread de busca executa o dpiStmt_fetchRows,
+// converte o bloco em termos num ambiente próprio (ErlNifEnv) e o envia
+// como mensagem ao processo consumidor; o enif_send transfere os termos sem
+// copiá-los. Enquanto o processo trata o bloco N, o bloco N+1 já está sendo
+// buscado: a thread só pode estar FETCH_PIPELINE_SLOTS blocos à frente do
+// que foi confirmado pelo fetch_pipeline_ack. Enquanto o pipeline existir,
+// o dpiStmt só é usado pela thread de busca.
+
+#include <string.h>
+#include "dpiFetch_nif.h"
+#include "dpiCleanup_nif.h"
+
+#define FETCH_PIPELINE_SLOTS 2
+
+struct fetch_pipeline {
+  dpiContext *context;
+  dpiStmt *stmt;
+  uint32_t numColumns;
+  data_encoder *encoders;
+  uint32_t maxRows;
+  ErlNifMutex *lock;
+  ErlNifCond *cond;
+  ErlNifTid thread;
+  ErlNifPid pid;
+  ErlNifEnv *env;
+  ErlNifEnv *refEnv;
+  ERL_NIF_TERM ref;
+  unsigned sent;
+  unsigned acked;
+  int started;
+  int stopping;
+};
+
+
+// Busca e converte um bloco, montando no ambiente da thread a mensagem
+// {ref, {:rows | :last, linhas}} ou {ref, {:error, msg}}.
+static ERL_NIF_TERM fetch_pipeline_fill(fetch_pipeline *pipeline,
+    int *last)
+{
+  uint32_t bufferRowIndex, numRows;
+  ErlNifEnv *env = pipeline->env;
+  ERL_NIF_TERM rows, result;
+  dpiErrorInfo info;
+  unsigned char *ptr;
+  int moreRows = 0;
+
+  if (dpiStmt_fetchRows(pipeline->stmt, pipeline->maxRows, &bufferRowIndex,
+          &numRows, &moreRows) < 0 ||
+      data_encode_rows(env, pipeline->stmt, pipeline->numColumns,
+          pipeline->encoders, bufferRowIndex, numRows, &rows) < 0) {
+    dpiContext_getError(pipeline->context, &info);
+    ptr = enif_make_new_binary(env, info.messageLength, &rows);
+    memcpy(ptr, info.message, info.messageLength);
+    result = enif_make_tuple2(env, enif_make_atom(env, "error"), rows);
+    *last = 1;
+  } else {
+    result = enif_make_tuple2(env,
+        enif_make_atom(env, moreRows ? "rows" : "last"), rows);
+    *last = !moreRows;
+  }
+  return enif_make_tuple2(env, enif_make_copy(env, pipeline->ref), result);
+}
+
+
+static void *fetch_pipeline_run(void *arg)
+{
+  fetch_pipeline *pipeline = arg;
+  ERL_NIF_TERM msg;
+  int last;
+
+  while (1) {
+    enif_mutex_lock(pipeline->lock);
+    while (!pipeline->stopping &&
+        pipeline->sent - pipeline->acked >= FETCH_PIPELINE_SLOTS)
+      enif_cond_wait(pipeline->cond, pipeline->lock);
+    if (pipeline->stopping) {
+      enif_mutex_unlock(pipeline->lock);
+      break;
+    }
+    enif_mutex_unlock(pipeline->lock);
+
+    msg = fetch_pipeline_fill(pipeline, &last);
+
+    // o envio fica sob o lock: depois do fetch_pipeline_stop nenhuma
+    // mensagem nova chega ao processo; o enif_send invalida os termos do
+    // ambiente, que é limpo antes do próximo bloco
+    enif_mutex_lock(pipeline->lock);
+    if (!pipeline->stopping) {
+      enif_send(NULL, &pipeline->pid, pipeline->env, msg);
+      pipeline->sent++;
+    }
+    enif_clear_env(pipeline->env);
+    enif_mutex_unlock(pipeline->lock);
+    if (last)
+      break;
+  }
+  return NULL;
+}
+
+
+// Executada pela thread de limpeza: espera a thread de busca terminar o
+// bloco em andamento e só então fecha o cursor.
+static void fetch_pipeline_free(void *arg)
+{
+  fetch_pipeline *pipeline = arg;
+
+  if (pipeline->started)
+    enif_thread_join(pipeline->thread, NULL);
+  if (pipeline->encoders)
+    data_encoders_free(pipeline->encoders);
+  if (pipeline->stmt)
+    dpiStmt_release(pipeline->stmt);
+  if (pipeline->env)
+    enif_free_env(pipeline->env);
+  if (pipeline->refEnv)
+    enif_free_env(pipeline->refEnv);
+  if (pipeline->cond)
+    enif_cond_destroy(pipeline->cond);
+  if (pipeline->lock)
+    enif_mutex_destroy(pipeline->lock);
+  enif_free(pipeline);
+}
+
+
+// Inicia a busca; os blocos são enviados ao processo que chamou o NIF,
+// marcados com ref. Em caso de sucesso o pipeline passa a ser dono do
+// dpiStmt e dos conversores.
+fetch_pipeline *fetch_pipeline_start(dpiContext *context, dpiStmt *stmt,
+    uint32_t numColumns, data_encoder *encoders, uint32_t maxRows,
+    ErlNifEnv *env, ERL_NIF_TERM ref)
+{
+  fetch_pipeline *pipeline;
+
+  pipeline = enif_alloc(sizeof(fetch_pipeline));
+  if (!pipeline)
+    return NULL;
+  memset(pipeline, 0, sizeof(fetch_pipeline));
+  pipeline->context = context;
+  pipeline->stmt = stmt;
+  pipeline->numColumns = numColumns;
+  pipeline->encoders = encoders;
+  pipeline->maxRows = maxRows;
+  enif_self(env, &pipeline->pid);
+  pipeline->lock = enif_mutex_create("oracle_nif_fetch_lock");
+  pipeline->cond = enif_cond_create("oracle_nif_fetch_cond");
+  pipeline->env = enif_alloc_env();
+  pipeline->refEnv = enif_alloc_env();
+  if (pipeline->refEnv)
+    pipeline->ref = enif_make_copy(pipeline->refEnv, ref);
+  if (!pipeline->lock || !pipeline->cond || !pipeline->env ||
+      !pipeline->refEnv ||
+      enif_thread_create("oracle_nif_fetch", &pipeline->thread,
+          fetch_pipeline_run, pipeline, NULL) != 0) {
+    pipeline->stmt = NULL;
+    pipeline->encoders = NULL;
+    fetch_pipeline_free(pipeline);
+    return NULL;
+  }
+  pipeline->started = 1;
+  return pipeline;
+}
+
+
+// O processo terminou de tratar um bloco: a thread pode buscar mais um.
+void fetch_pipeline_ack(fetch_pipeline *pipeline)
+{
+  enif_mutex_lock(pipeline->lock);
+  pipeline->acked++;
+  enif_cond_signal(pipeline->cond);
+  enif_mutex_unlock(pipeline->lock);
+}
+
+
+// Interrompe o pipeline sem esperar: a thread de busca para depois do bloco
+// em andamento (que não é mais enviado) e a thread de limpeza libera o
+// pipeline, o dpiStmt e os conversores.
+void fetch_pipeline_stop(fetch_pipeline *pipeline)
+{
+  enif_mutex_lock(pipeline->lock);
+  pipeline->stopping = 1;
+  enif_cond_broadcast(pipeline->cond);
+  enif_mutex_unlock(pipeline->lock);
+  cleanup_schedule(fetch_pipeline_free, pipeline);
+}
@@ -0,0 +1,18 @@
+#ifndef DPIFETCH_NIF_H
+#define DPIFETCH_NIF_H
+
+#include <erl_nif.h>
+#include "dpi.h"
+#include "dpiData_nif.h"
+
+// Busca em pipeline: uma thread busca e converte o próximo bloco de linhas
+// e o envia ao processo Erlang enquanto o bloco anterior é consumido.
+typedef struct fetch_pipeline fetch_pipeline;
+
+fetch_pipeline *fetch_pipeline_start(dpiContext *context, dpiStmt *stmt,
+    uint32_t numColumns, data_encoder *encoders, uint32_t maxRows,
+    ErlNifEnv *env, ERL_NIF_TERM ref);
+void fetch_pipeline_ack(fetch_pipeline *pipeline);
+void fetch_pipeline_stop(fetch_pipeline *pipeline);
+
+#endif
@@ -24,11 +24,49 @@
 static dpiEnv *dpiGlobalEnv;
 static dpiErrorBuffer dpiGlobalErrorBuffer;
 
+// character set lookups performed via OCI are retained for the life of the
+// process so that environments created later (such as one per session pool)
+// do not need to repeat them; entries are never modified once added and the
+// global environment's mutex protects the number of entries in use
+typedef struct {
+    uint16_t charsetId;
+    char name[DPI_OCI_NLS_MAXBUFSZ];
+} dpiCharsetCacheEntry;
+static dpiCharsetCacheEntry dpiGlobalCharsetsByName[DPI_CHARSET_CACHE_SIZE];
+static dpiCharsetCacheEntry dpiGlobalEncodingsById[DPI_CHARSET_CACHE_SIZE];
+static uint32_t dpiGlobalNumCharsetsByName;
+static uint32_t dpiGlobalNumEncodingsById;
+
 // debug level is maintained here and is populated by reading the environment
 // variable DPI_DEBUG_LEVEL when the global environment is created
 long dpiDebugLevel = 0;
 
 
+//-----------------------------------------------------------------------------
+// dpiGlobal__addToCharsetCache() [INTERNAL]
+//   Add an entry to one of the character set caches, if space permits. A
+// failure to acquire the mutex simply means the entry is not cached.
+//-----------------------------------------------------------------------------
+static void dpiGlobal__addToCharsetCache(dpiCharsetCacheEntry *entries,
+        uint32_t *numEntries, const char *name, uint16_t charsetId,
+        dpiError *error)
+{
+    dpiCharsetCacheEntry *entry;
+
+    if (strlen(name) >= DPI_OCI_NLS_MAXBUFSZ)
+        return;
+    if (dpiOci__threadMutexAcquire(dpiGlobalEnv, error) < 0)
+        return;
+    if (*numEntries < DPI_CHARSET_CACHE_SIZE) {
+        entry = &entries[*numEntries];
+        entry->charsetId = charsetId;
+        strcpy(entry->name, name);
+        *numEntries += 1;
+    }
+    dpiOci__threadMutexRelease(dpiGlobalEnv, error);
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiGlobal__createEnv() [INTERNAL]
 //   Create the global environment used for managing error buffers in a
@@ -74,6 +112,12 @@ static int dpiGlobal__createEnv(const char *fnName, dpiError *error)
         return DPI_FAILURE;
     }
 
+    // create mutex used for protecting the character set cache
+    if (dpiOci__threadMutexInit(tempEnv, &tempEnv->mutex, error) < 0) {
+        dpiEnv__free(tempEnv, error);
+        return DPI_FAILURE;
+    }
+
     // store these in global state
     // NOTE: this is not thread safe; two threads could attempt to call this
     // function at the same time even though it is documented that they should
@@ -93,6 +137,32 @@ static int dpiGlobal__createEnv(const char *fnName, dpiError *error)
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiGlobal__findInCharsetCache() [INTERNAL]
+//   Search one of the character set caches for an entry matching either the
+// name (if one is specified) or the character set id. Returns a pointer to the
+// entry or NULL if no matching entry is found.
+//-----------------------------------------------------------------------------
+static dpiCharsetCacheEntry *dpiGlobal__findInCharsetCache(
+        dpiCharsetCacheEntry *entries, uint32_t *numEntries, const char *name,
+        uint16_t charsetId, dpiError *error)
+{
+    uint32_t i, numEntriesInUse;
+
+    if (dpiOci__threadMutexAcquire(dpiGlobalEnv, error) < 0)
+        return NULL;
+    numEntriesInUse = *numEntries;
+    dpiOci__threadMutexRelease(dpiGlobalEnv, error);
+    for (i = 0; i < numEntriesInUse; i++) {
+        if (name && strcmp(entries[i].name, name) == 0)
+            return &entries[i];
+        if (!name && entries[i].charsetId == charsetId)
+            return &entries[i];
+    }
+    return NULL;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiGlobal__initError() [INTERNAL]
 //   Get the thread local error structure for use in all other functions. If
@@ -161,6 +231,7 @@ int dpiGlobal__lookupCharSet(const char *name, uint16_t *charsetId,
         dpiError *error)
 {
     char oraCharsetName[DPI_OCI_NLS_MAXBUFSZ];
+    dpiCharsetCacheEntry *entry;
 
     // check for well-known encodings first
     if (strcmp(name, DPI_CHARSET_NAME_UTF8) == 0)
@@ -173,6 +244,11 @@ int dpiGlobal__lookupCharSet(const char *name, uint16_t *charsetId,
             strcmp(name, DPI_CHARSET_NAME_UTF16BE) == 0)
         return dpiError__set(error, "check encoding", DPI_ERR_NOT_SUPPORTED);
 
+    // check for names that have already been looked up
+    else if ((entry = dpiGlobal__findInCharsetCache(dpiGlobalCharsetsByName,
+            &dpiGlobalNumCharsetsByName, name, 0, error)) != NULL)
+        *charsetId = entry->charsetId;
+
     // perform lookup; check for the Oracle character set name first and if
     // that fails, lookup using the IANA character set name
     else {
@@ -188,6 +264,9 @@ int dpiGlobal__lookupCharSet(const char *name, uint16_t *charsetId,
             dpiOci__nlsCharSetNameToId(dpiGlobalEnv, oraCharsetName, charsetId,
                     error);
         }
+        if (*charsetId)
+            dpiGlobal__addToCharsetCache(dpiGlobalCharsetsByName,
+                    &dpiGlobalNumCharsetsByName, name, *charsetId, error);
     }
 
     return DPI_SUCCESS;
@@ -203,6 +282,7 @@ int dpiGlobal__lookupEncoding(uint16_t charsetId, char *encoding,
         dpiError *error)
 {
     char oracleName[DPI_OCI_NLS_MAXBUFSZ];
+    dpiCharsetCacheEntry *entry;
 
     // check for well-known encodings first
     switch (charsetId) {
@@ -217,6 +297,14 @@ int dpiGlobal__lookupEncoding(uint16_t charsetId, char *encoding,
             return DPI_SUCCESS;
     }
 
+    // check for character sets that have already been looked up
+    entry = dpiGlobal__findInCharsetCache(dpiGlobalEncodingsById,
+            &dpiGlobalNumEncodingsById, NULL, charsetId, error);
+    if (entry) {
+        strcpy(encoding, entry->name);
+        return DPI_SUCCESS;
+    }
+
     // get character set name
     if (dpiOci__nlsCharSetIdToName(dpiGlobalEnv, oracleName,
             sizeof(oracleName), charsetId, error) < 0)
@@ -228,6 +316,8 @@ int dpiGlobal__lookupEncoding(uint16_t charsetId, char *encoding,
             oracleName, DPI_OCI_NLS_CS_ORA_TO_IANA, error) < 0)
         return dpiError__set(error, "lookup IANA name",
                 DPI_ERR_INVALID_CHARSET_ID, charsetId);
+    dpiGlobal__addToCharsetCache(dpiGlobalEncodingsById,
+            &dpiGlobalNumEncodingsById, encoding, charsetId, error);
 
     return DPI_SUCCESS;
 }
@@ -47,6 +47,21 @@ extern long dpiDebugLevel;
 // define internal chunk size used for dynamic binding/fetching
 #define DPI_DYNAMIC_BYTES_CHUNK_SIZE                65536
 
+// define number of temporary LOBs kept by each connection for reuse and the
+// maximum length (in characters or bytes) of a temporary LOB that is kept
+#define DPI_TEMP_LOB_CACHE_SIZE                     32
+#define DPI_TEMP_LOB_CACHE_MAX_LENGTH               32768
+
+// define limits used when the fetch array size is adjusted automatically; the
+// array size is halved when the time taken per row exceeds the lowest seen by
+// the given factor
+#define DPI_ADAPTIVE_FETCH_MAX_ARRAY_SIZE           65536
+#define DPI_ADAPTIVE_FETCH_MAX_SLOWDOWN             4
+
+// define number of previously fetched blocks of rows retained by scrollable
+// statements
+#define DPI_SCROLL_CACHE_MAX_WINDOWS                4
+
 // define well-known character sets
 #define DPI_CHARSET_ID_ASCII                        1
 #define DPI_CHARSET_ID_UTF8                         873
@@ -56,6 +71,10 @@ extern long dpiDebugLevel;
 #define DPI_CHARSET_NAME_UTF16                      "UTF-16"
 #define DPI_CHARSET_NAME_UTF16LE                    "UTF-16LE"
 #define DPI_CHARSET_NAME_UTF16BE                    "UTF-16BE"
+#define DPI_CHARSET_UTF8_MAX_BYTES_PER_CHAR         4
+
+// define number of character set lookups retained by the global environment
+#define DPI_CHARSET_CACHE_SIZE                      16
 
 // define handle types used for allocating OCI handles
 #define DPI_OCI_HTYPE_ENV                           1
@@ -103,6 +122,7 @@ extern long dpiDebugLevel;
 #define DPI_OCI_ATTR_SCHEMA_NAME                    9
 #define DPI_OCI_ATTR_ROW_COUNT                      9
 #define DPI_OCI_ATTR_PREFETCH_ROWS                  11
+#define DPI_OCI_ATTR_PREFETCH_MEMORY                13
 #define DPI_OCI_ATTR_PARAM_COUNT                    18
 #define DPI_OCI_ATTR_USERNAME                       22
 #define DPI_OCI_ATTR_PASSWORD                       23
@@ -314,6 +334,7 @@ extern long dpiDebugLevel;
 #define DPI_OCI_AUTH                                8
 #define DPI_OCI_DURATION_SESSION                    10
 #define DPI_OCI_NUMBER_SIZE                         22
+#define DPI_OCI_NEED_DATA                           99
 #define DPI_OCI_NO_DATA                             100
 #define DPI_OCI_STRLS_CACHE_DELETE                  0x0010
 #define DPI_OCI_THREADED                            0x00000001
@@ -542,6 +563,19 @@ typedef struct {
     uint32_t nameLength;
 } dpiBindVar;
 
+typedef struct {
+    void *locator;
+    dpiOracleTypeNum oracleTypeNum;
+} dpiTempLob;
+
+typedef struct {
+    uint64_t minRow;
+    uint32_t numRows;
+    uint64_t lastUsed;
+    char *buffer;
+    size_t bufferSize;
+} dpiScrollWindow;
+
 
 //-----------------------------------------------------------------------------
 // External implementation type definitions
@@ -555,6 +589,7 @@ struct dpiPool {
     int pingTimeout;
     int homogeneous;
     int externalAuth;
+    dpiPoolMetrics metrics;
 };
 
 struct dpiConn {
@@ -573,6 +608,13 @@ struct dpiConn {
     int dropSession;
     int standalone;
     int closing;
+    uint32_t prefetchRows;
+    uint32_t prefetchMemory;
+    int hasPrefetchRows;
+    int hasPrefetchMemory;
+    uint32_t inlineLobSize;
+    dpiTempLob *tempLobs;
+    uint32_t numTempLobs;
 };
 
 struct dpiContext {
@@ -603,6 +645,19 @@ struct dpiStmt {
     int scrollable;
     int isReturning;
     int deleteFromCache;
+    uint32_t adaptiveFetchBufferSize;
+    uint32_t adaptiveFetchMaxArraySize;
+    uint64_t lastFetchTime;
+    uint32_t lastFetchRows;
+    uint64_t minRowFetchTime;
+    uint32_t prefetchRows;
+    uint32_t prefetchMemory;
+    int hasPrefetchRows;
+    int hasPrefetchMemory;
+    uint32_t inlineLobSize;
+    dpiScrollWindow *scrollWindows;
+    uint64_t scrollWindowUseCount;
+    int scrollWindowRestored;
 };
 
 typedef union {
@@ -657,11 +712,14 @@ struct dpiVar {
     int requiresPreFetch;
     int isArray;
     int16_t *indicator;
+    uint64_t *nullBitmap;
+    uint32_t numNulls;
     uint16_t *returnCode;
     uint16_t *actualLength16;
     uint32_t *actualLength32;
     uint32_t sizeInBytes;
     int isDynamic;
+    uint32_t dynamicChunkSize;
     dpiObjectType *objectType;
     void **objectIndicator;
     dpiReferenceBuffer *references;
@@ -860,6 +918,8 @@ const dpiOracleType *dpiOracleType__getFromObjectTypeInfo(uint16_t typeCode,
 //-----------------------------------------------------------------------------
 // definition of internal dpiConn methods
 //-----------------------------------------------------------------------------
+int dpiConn__cacheTempLob(dpiConn *conn, const dpiOracleType *type,
+        void *locator, int *cached, dpiError *error);
 int dpiConn__decrementOpenChildCount(dpiConn *conn, dpiError *error);
 void dpiConn__free(dpiConn *conn, dpiError *error);
 int dpiConn__get(dpiConn *conn, const char *userName, uint32_t userNameLength,
@@ -868,6 +928,8 @@ int dpiConn__get(dpiConn *conn, const char *userName, uint32_t userNameLength,
         dpiConnCreateParams *createParams, dpiPool *pool, dpiError *error);
 int dpiConn__getServerVersion(dpiConn *conn, dpiError *error);
 int dpiConn__incrementOpenChildCount(dpiConn *conn, dpiError *error);
+int dpiConn__takeTempLob(dpiConn *conn, const dpiOracleType *type,
+        void **locator, dpiError *error);
 
 
 //-----------------------------------------------------------------------------
@@ -882,12 +944,19 @@ void dpiPool__free(dpiPool *pool, dpiError *error);
 //-----------------------------------------------------------------------------
 // definition of internal dpiStmt methods
 //-----------------------------------------------------------------------------
+void dpiStmt__adjustFetchArraySize(dpiStmt *stmt);
 int dpiStmt__allocate(dpiConn *conn, int scrollable, dpiStmt **stmt,
         dpiError *error);
 void dpiStmt__free(dpiStmt *stmt, dpiError *error);
+void dpiStmt__getFetchMode(dpiStmt *stmt, uint64_t desiredRow,
+        dpiFetchMode *mode, int32_t *offset);
 int dpiStmt__init(dpiStmt *stmt, dpiError *error);
 int dpiStmt__prepare(dpiStmt *stmt, const char *sql, uint32_t sqlLength,
         const char *tag, uint32_t tagLength, dpiError *error);
+int dpiStmt__reset(dpiStmt *stmt, dpiError *error);
+int dpiStmt__restoreScrollWindow(dpiStmt *stmt, uint64_t desiredRow,
+        int *found, dpiError *error);
+void dpiStmt__saveScrollWindow(dpiStmt *stmt);
 
 
 //-----------------------------------------------------------------------------
@@ -897,6 +966,7 @@ int dpiVar__allocate(dpiConn *conn, dpiOracleTypeNum oracleTypeNum,
         dpiNativeTypeNum nativeTypeNum, uint32_t maxArraySize, uint32_t size,
         int sizeIsBytes, int isArray, dpiObjectType *objType, dpiVar **var,
         dpiData **data, dpiError *error);
+int dpiVar__convertToLength32(dpiVar *var, dpiError *error);
 int dpiVar__convertToLob(dpiVar *var, dpiError *error);
 int dpiVar__copyData(dpiVar *var, uint32_t pos, dpiData *sourceData,
         dpiError *error);
@@ -910,11 +980,14 @@ int32_t dpiVar__inBindCallback(dpiVar *var, void *bindp, uint32_t iter,
         void **indpp);
 int dpiVar__getValue(dpiVar *var, uint32_t pos, dpiData *data,
         dpiError *error);
+int dpiVar__getValues(dpiVar *var, uint32_t start, uint32_t count,
+        dpiError *error);
 int dpiVar__setValue(dpiVar *var, uint32_t pos, dpiData *data,
         dpiError *error);
 int32_t dpiVar__outBindCallback(dpiVar *var, void *bindp, uint32_t iter,
         uint32_t index, void **bufpp, uint32_t **alenpp, uint8_t *piecep,
         void **indpp, uint16_t **rcodepp);
+void dpiVar__restoreLength16(dpiVar *var);
 
 
 //-----------------------------------------------------------------------------
@@ -922,6 +995,7 @@ int32_t dpiVar__outBindCallback(dpiVar *var, void *bindp, uint32_t iter,
 //-----------------------------------------------------------------------------
 int dpiLob__allocate(dpiConn *conn, const dpiOracleType *type, dpiLob **lob,
         dpiError *error);
+int dpiLob__createTemporary(dpiLob *lob, int *reused, dpiError *error);
 void dpiLob__free(dpiLob *lob, dpiError *error);
 int dpiLob__readBytes(dpiLob *lob, uint64_t offset, uint64_t amount,
         char *value, uint64_t *valueLength, dpiError *error);
@@ -1082,7 +1156,8 @@ int dpiOci__lobFileSetName(dpiLob *lob, const char *dirAlias,
         uint16_t dirAliasLength, const char *name, uint16_t nameLength,
         dpiError *error);
 int dpiOci__lobFlushBuffer(dpiLob *lob, dpiError *error);
-int dpiOci__lobFreeTemporary(dpiLob *lob, int checkError, dpiError *error);
+int dpiOci__lobFreeTemporary(dpiConn *conn, void *locator, int checkError,
+        dpiError *error);
 int dpiOci__lobGetChunkSize(dpiLob *lob, uint32_t *size, dpiError *error);
 int dpiOci__lobGetLength2(dpiLob *lob, uint64_t *size, dpiError *error);
 int dpiOci__lobIsOpen(dpiLob *lob, int *isOpen, dpiError *error);
@@ -1096,7 +1171,7 @@ int dpiOci__lobRead2(dpiLob *lob, uint64_t offset, uint64_t *amountInBytes,
         dpiError *error);
 int dpiOci__lobTrim2(dpiLob *lob, uint64_t newLength, dpiError *error);
 int dpiOci__lobWrite2(dpiLob *lob, uint64_t offset, const char *value,
-        uint64_t valueLength, dpiError *error);
+        uint64_t valueLength, uint8_t piece, dpiError *error);
 int dpiOci__memoryAlloc(dpiConn *conn, void **ptr, uint32_t size,
         int checkError, dpiError *error);
 int dpiOci__memoryFree(dpiConn *conn, void *ptr, dpiError *error);
@@ -1234,6 +1309,7 @@ void dpiUtils__clearMemory(void *ptr, size_t length);
 int dpiUtils__getAttrStringWithDup(const char *action, const void *ociHandle,
         uint32_t ociHandleType, uint32_t ociAttribute, const char **value,
         uint32_t *valueLength, dpiError *error);
+uint64_t dpiUtils__getMonotonicTime(void);
 int dpiUtils__parseNumberString(const char *value, uint32_t valueLength,
         uint16_t charsetId, int *isNegative, int16_t *decimalPointIndex,
         uint8_t *numDigits, uint8_t *digits, dpiError *error);
@@ -0,0 +1,94 @@
+// dpiImplicit_nif.c
+// Resultados implícitos (DBMS_SQL.RETURN_RESULT) de um bloco PL/SQL, todos
+// numa única chamada ao NIF. O dpiStmt_getImplicitResults obtém os cursores
+// filhos de uma vez e já faz a primeira busca de cada um; depois as linhas
+// que faltam de cada filho são buscadas em sequência. Uma sessão só atende
+// uma chamada por vez, então os filhos não são buscados em paralelo e as
+// idas ao banco são as mesmas de buscar um resultado por vez: o ganho é
+// montar tudo num só dirty scheduler, sem uma chamada ao NIF (e uma
+// mensagem) por resultado ou por bloco.
+
+#include "dpiImplicit_nif.h"
+#include "dpiConn_nif.h"
+#include "dpiData_nif.h"
+
+// quantos cursores filhos são obtidos por chamada a dpiStmt_getImplicitResults
+#define IMPLICIT_RESULTS_BATCH 16
+
+static ERL_NIF_TERM atom_ok;
+
+
+int implicit_load(ErlNifEnv *env)
+{
+  atom_ok = enif_make_atom(env, "ok");
+  return 0;
+}
+
+
+// Busca as linhas de cada filho, liberando todos eles (mesmo após uma
+// falha), e acrescenta uma lista de linhas por filho a *results, na ordem
+// inversa.
+static int implicit_fetch_children(ErlNifEnv *env, dpiStmt **children,
+    uint32_t numChildren, uint32_t arraySize, ERL_NIF_TERM *results)
+{
+  int status = DPI_SUCCESS;
+  uint32_t i, numColumns;
+  ERL_NIF_TERM rows;
+
+  for (i = 0; i < numChildren; i++) {
+    if (status == DPI_SUCCESS &&
+        (dpiStmt_getNumQueryColumns(children[i], &numColumns) < 0 ||
+        data_fetch_all(env, children[i], numColumns, arraySize,
+            &rows) < 0))
+      status = DPI_FAILURE;
+    if (status == DPI_SUCCESS)
+      *results = enif_make_list_cell(env, rows, *results);
+    dpiStmt_release(children[i]);
+  }
+  return status;
+}
+
+
+// implicit_results(conn, sql, rows_per_fetch) -> {:ok, [linhas, ...]} |
+// {:error, msg}; uma lista de linhas por resultado implícito, na ordem em
+// que o bloco PL/SQL os devolveu
+ERL_NIF_TERM implicit_results(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  dpiStmt *stmt = NULL, *children[IMPLICIT_RESULTS_BATCH];
+  ERL_NIF_TERM results, reversed;
+  uint32_t numColumns, numChildren;
+  unsigned arraySize;
+  ErlNifBinary sql;
+  dpiConn *conn;
+
+  if (!conn_get_conn(env, argv[0], &conn) ||
+      !enif_inspect_binary(env, argv[1], &sql) ||
+      !enif_get_uint(env, argv[2], &arraySize) || arraySize == 0)
+    return enif_make_badarg(env);
+
+  // os filhos herdam o tamanho de busca do bloco PL/SQL
+  if (dpiConn_prepareStmt(conn, 0, (const char*) sql.data, sql.size,
+          NULL, 0, &stmt) < 0 ||
+      dpiStmt_setFetchArraySize(stmt, arraySize) < 0 ||
+      dpiStmt_execute(stmt, DPI_MODE_EXEC_DEFAULT, &numColumns) < 0)
+    goto error;
+  results = enif_make_list(env, 0);
+  do {
+    numChildren = IMPLICIT_RESULTS_BATCH;
+    if (dpiStmt_getImplicitResults(stmt, &numChildren, children) < 0 ||
+        implicit_fetch_children(env, children, numChildren, arraySize,
+            &results) < 0)
+      goto error;
+  } while (numChildren == IMPLICIT_RESULTS_BATCH);
+  dpiStmt_release(stmt);
+  if (!enif_make_reverse_list(env, results, &reversed))
+    return enif_make_badarg(env);
+  return enif_make_tuple2(env, atom_ok, reversed);
+
+error:
+  results = conn_make_error(env);
+  if (stmt)
+    dpiStmt_release(stmt);
+  return results;
+}
@@ -0,0 +1,12 @@
+#ifndef DPIIMPLICIT_NIF_H
+#define DPIIMPLICIT_NIF_H
+
+#include <erl_nif.h>
+#include "dpi.h"
+
+int implicit_load(ErlNifEnv *env);
+
+ERL_NIF_TERM implicit_results(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+
+#endif
@@ -73,17 +73,31 @@ int dpiLob__check(dpiLob *lob, const char *fnName, dpiError *error)
 //-----------------------------------------------------------------------------
 static int dpiLob__close(dpiLob *lob, int propagateErrors, dpiError *error)
 {
-    int isTemporary;
+    int isTemporary, cached = 0;
+    uint64_t length;
 
     if (lob->locator) {
         if (dpiOci__lobIsTemporary(lob, &isTemporary, propagateErrors,
                 error) < 0)
             return DPI_FAILURE;
-        if (isTemporary) {
-            if (dpiOci__lobFreeTemporary(lob, propagateErrors, error) < 0)
+
+        // small temporary LOBs are kept by the connection for reuse, if
+        // possible; they are not emptied here as most are overwritten by
+        // dpiLob__setFromBytes() anyway; larger ones are freed so that a
+        // connection left idle (in a pool, for example) does not hold their
+        // space in the temporary tablespace
+        if (isTemporary && dpiOci__lobGetLength2(lob, &length, error) == 0 &&
+                length <= DPI_TEMP_LOB_CACHE_MAX_LENGTH &&
+                dpiConn__cacheTempLob(lob->conn, lob->type, lob->locator,
+                        &cached, error) < 0)
+            cached = 0;
+        if (isTemporary && !cached) {
+            if (dpiOci__lobFreeTemporary(lob->conn, lob->locator,
+                    propagateErrors, error) < 0)
                 return DPI_FAILURE;
         }
-        dpiOci__descriptorFree(lob->locator, DPI_OCI_DTYPE_LOB);
+        if (!cached)
+            dpiOci__descriptorFree(lob->locator, DPI_OCI_DTYPE_LOB);
         lob->locator = NULL;
         dpiConn__decrementOpenChildCount(lob->conn, error);
     }
@@ -100,6 +114,29 @@ static int dpiLob__close(dpiLob *lob, int propagateErrors, dpiError *error)
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiLob__createTemporary() [INTERNAL]
+//   Make the LOB a temporary LOB. A temporary LOB of the same type kept by the
+// connection is used, if one is available; otherwise a new temporary LOB is
+// created, which requires a round trip to the database. A reused temporary
+// LOB may still contain data, which is indicated by the reused flag.
+//-----------------------------------------------------------------------------
+int dpiLob__createTemporary(dpiLob *lob, int *reused, dpiError *error)
+{
+    void *locator;
+
+    *reused = 0;
+    if (dpiConn__takeTempLob(lob->conn, lob->type, &locator, error) < 0)
+        return DPI_FAILURE;
+    if (!locator)
+        return dpiOci__lobCreateTemporary(lob, error);
+    *reused = 1;
+    dpiOci__descriptorFree(lob->locator, DPI_OCI_DTYPE_LOB);
+    lob->locator = locator;
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiLob__free() [INTERNAL]
 //   Free the memory for a LOB.
@@ -163,7 +200,8 @@ int dpiLob__setFromBytes(dpiLob *lob, const char *value, uint64_t valueLength,
         return DPI_FAILURE;
     if (valueLength == 0)
         return DPI_SUCCESS;
-    return dpiOci__lobWrite2(lob, 1, value, valueLength, error);
+    return dpiOci__lobWrite2(lob, 1, value, valueLength, DPI_OCI_ONE_PIECE,
+            error);
 }
 
 
@@ -465,6 +503,28 @@ int dpiLob_writeBytes(dpiLob *lob, uint64_t offset, const char *value,
     if (dpiLob__check(lob, __func__, &error) < 0)
         return DPI_FAILURE;
     DPI_CHECK_PTR_NOT_NULL(value)
-    return dpiOci__lobWrite2(lob, offset, value, valueLength, &error);
+    return dpiOci__lobWrite2(lob, offset, value, valueLength,
+            DPI_OCI_ONE_PIECE, &error);
+}
+
+
+//-----------------------------------------------------------------------------
+// dpiLob_writePiece() [PUBLIC]
+//   Write one piece of a value to the LOB, starting at the offset given with
+// the first piece. The total length does not need to be known in advance.
+// Until the last piece has been written, no other calls may be made using the
+// LOB's connection.
+//-----------------------------------------------------------------------------
+int dpiLob_writePiece(dpiLob *lob, uint64_t offset, const char *value,
+        uint64_t valueLength, dpiLobPiece piece)
+{
+    dpiError error;
+
+    if (dpiLob__check(lob, __func__, &error) < 0)
+        return DPI_FAILURE;
+    if (valueLength > 0)
+        DPI_CHECK_PTR_NOT_NULL(value)
+    return dpiOci__lobWrite2(lob, offset, value, valueLength, (uint8_t) piece,
+            &error);
 }
 
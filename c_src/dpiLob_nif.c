@@ -0,0 +1,798 @@
+// dpiLob_nif.c
+// Leitura de LOBs em partes, para o OracleNif.lob_stream/2. Cada leitura é
+// de um múltiplo do tamanho de chunk do LOB (dpiLob_getChunkSize), evitando
+// que o servidor leia chunks pela metade, e uma thread já lê a parte
+// seguinte enquanto o processo Erlang consome a atual. A memória usada fica
+// em duas partes, qualquer que seja o tamanho do LOB. Cada parte é lida
+// direto num binário (enif_alloc_binary), que é entregue ao processo Erlang
+// sem cópia; o lob_read faz o mesmo com o LOB inteiro. O estado do leitor
+// fica fora do recurso: o lob_stream_close e o destrutor só interrompem a
+// thread, que é esperada e liberada pela thread de limpeza.
+// A escrita é o caminho inverso: as partes enviadas pelo processo Erlang
+// entram numa fila limitada e uma thread as grava com dpiLob_writePiece
+// (OCILobWrite2 por partes), sem precisar do valor inteiro na memória.
+// Com a fila cheia, lob_writer_write espera: é essa a contrapressão sobre
+// quem produz os dados. Enquanto a escrita está aberta a conexão fica
+// marcada como ocupada; uma escrita por partes que falha ou é abandonada é
+// interrompida com dpiConn_breakExecution, para não deixar a sessão no meio
+// de um OCILobWrite2.
+
+#include <string.h>
+#include "dpiLob_nif.h"
+#include "dpiConn_nif.h"
+#include "dpiCleanup_nif.h"
+
+#define LOB_READER_SLOTS 2
+
+// tamanho aproximado de cada parte, em unidades do LOB (bytes para BLOB e
+// BFILE, caracteres para CLOB e NCLOB)
+#define LOB_READER_PIECE_SIZE (1024 * 1024)
+
+// partes aguardando gravação, no máximo
+#define LOB_WRITER_SLOTS 4
+
+#define LOB_NO_MEMORY "out of memory"
+
+typedef struct {
+  ErlNifBinary data;
+  size_t length;
+  int allocated;
+  int status;
+  ErlNifEnv *env;
+  ERL_NIF_TERM error;
+} lob_reader_slot;
+
+typedef struct {
+  dpiLob *lob;
+  int openedResource;
+  uint64_t size;
+  uint64_t offset;
+  uint64_t pieceAmount;
+  uint64_t bufferSize;
+  ErlNifMutex *lock;
+  ErlNifCond *cond;
+  ErlNifTid thread;
+  lob_reader_slot slots[LOB_READER_SLOTS];
+  unsigned produced;
+  unsigned consumed;
+  int started;
+  int stopping;
+  int finished;
+} lob_reader;
+
+// Recurso Erlang do leitor; o callLock serializa as chamadas feitas com ele.
+typedef struct {
+  ErlNifMutex *callLock;
+  lob_reader *reader;
+} lob_reader_resource;
+
+// Cada parte guarda uma cópia do termo num ambiente próprio; binários
+// grandes (refc) são compartilhados, não copiados.
+typedef struct {
+  ErlNifEnv *env;
+  ErlNifBinary data;
+} lob_writer_slot;
+
+typedef struct {
+  conn_resource *connRes;
+  dpiConn *conn;
+  dpiLob *lob;
+  ErlNifMutex *lock;
+  ErlNifCond *cond;
+  ErlNifTid thread;
+  lob_writer_slot slots[LOB_WRITER_SLOTS];
+  unsigned produced;
+  unsigned written;
+  int started;
+  int closing;
+  int aborting;
+  int failed;
+  int finished;
+  ErlNifEnv *errorEnv;
+  ERL_NIF_TERM error;
+} lob_writer;
+
+// Recurso Erlang do escritor; o estado fica fora dele pelo mesmo motivo que
+// o do leitor.
+typedef struct {
+  lob_writer *writer;
+} lob_writer_resource;
+
+static ErlNifResourceType *lob_reader_type;
+static ErlNifResourceType *lob_writer_type;
+static ERL_NIF_TERM atom_ok;
+static ERL_NIF_TERM atom_error;
+static ERL_NIF_TERM atom_done;
+static ERL_NIF_TERM atom_nil;
+
+
+// Lê a próxima parte num binário novo, já que o anterior foi entregue ao
+// processo Erlang; em caso de erro a mensagem vira um binário.
+static void lob_reader_fill(lob_reader *reader, lob_reader_slot *slot)
+{
+  dpiErrorInfo info;
+  unsigned char *ptr;
+  uint64_t amount, length;
+
+  amount = reader->size - reader->offset + 1;
+  if (amount > reader->pieceAmount)
+    amount = reader->pieceAmount;
+  if (!slot->allocated &&
+      !enif_alloc_binary(reader->bufferSize, &slot->data)) {
+    slot->status = DPI_FAILURE;
+    enif_clear_env(slot->env);
+    ptr = enif_make_new_binary(slot->env, strlen(LOB_NO_MEMORY),
+        &slot->error);
+    memcpy(ptr, LOB_NO_MEMORY, strlen(LOB_NO_MEMORY));
+    return;
+  }
+  slot->allocated = 1;
+  length = slot->data.size;
+  slot->status = dpiLob_readBytes(reader->lob, reader->offset, amount,
+      (char*) slot->data.data, &length);
+  if (slot->status == DPI_SUCCESS) {
+    slot->length = length;
+    reader->offset += amount;
+    return;
+  }
+  enif_clear_env(slot->env);
+  dpiContext_getError(conn_context(), &info);
+  ptr = enif_make_new_binary(slot->env, info.messageLength, &slot->error);
+  memcpy(ptr, info.message, info.messageLength);
+}
+
+
+static void *lob_reader_run(void *arg)
+{
+  lob_reader *reader = arg;
+  lob_reader_slot *slot;
+
+  while (1) {
+    enif_mutex_lock(reader->lock);
+    while (!reader->stopping &&
+        reader->produced - reader->consumed >= LOB_READER_SLOTS)
+      enif_cond_wait(reader->cond, reader->lock);
+    if (reader->stopping) {
+      enif_mutex_unlock(reader->lock);
+      break;
+    }
+    slot = &reader->slots[reader->produced % LOB_READER_SLOTS];
+    enif_mutex_unlock(reader->lock);
+
+    lob_reader_fill(reader, slot);
+
+    enif_mutex_lock(reader->lock);
+    reader->produced++;
+    if (slot->status != DPI_SUCCESS || reader->offset > reader->size)
+      reader->finished = 1;
+    enif_cond_broadcast(reader->cond);
+    enif_mutex_unlock(reader->lock);
+    if (reader->finished)
+      break;
+  }
+  return NULL;
+}
+
+
+// Executada pela thread de limpeza (ou direto, se a thread de leitura não
+// chegou a ser criada): espera a leitura em andamento e libera o LOB.
+static void lob_reader_free(void *arg)
+{
+  lob_reader *reader = arg;
+  int i;
+
+  if (reader->started)
+    enif_thread_join(reader->thread, NULL);
+  for (i = 0; i < LOB_READER_SLOTS; i++) {
+    if (reader->slots[i].allocated)
+      enif_release_binary(&reader->slots[i].data);
+    if (reader->slots[i].env)
+      enif_free_env(reader->slots[i].env);
+  }
+  if (reader->lob) {
+    if (reader->openedResource)
+      dpiLob_closeResource(reader->lob);
+    dpiLob_release(reader->lob);
+  }
+  if (reader->cond)
+    enif_cond_destroy(reader->cond);
+  if (reader->lock)
+    enif_mutex_destroy(reader->lock);
+  enif_free(reader);
+}
+
+
+// Interrompe o leitor sem esperar; chamado pelo lob_stream_close ou pelo
+// destrutor.
+static void lob_reader_stop(lob_reader *reader)
+{
+  enif_mutex_lock(reader->lock);
+  reader->stopping = 1;
+  enif_cond_broadcast(reader->cond);
+  enif_mutex_unlock(reader->lock);
+  cleanup_schedule(lob_reader_free, reader);
+}
+
+
+static void lob_reader_dtor(ErlNifEnv *env, void *obj)
+{
+  lob_reader_resource *res = obj;
+
+  if (res->reader)
+    lob_reader_stop(res->reader);
+  if (res->callLock)
+    enif_mutex_destroy(res->callLock);
+}
+
+
+// Grava as partes na ordem em que chegaram. Cada parte só é gravada quando
+// se sabe se há outra depois dela, para que a última vá como
+// DPI_LOB_PIECE_LAST (ou, se for a única, numa escrita simples). Se o
+// escritor for abandonado, a escrita por partes em aberto é interrompida.
+static void *lob_writer_run(void *arg)
+{
+  lob_writer *writer = arg;
+  lob_writer_slot *slot;
+  int first, last, open = 0;
+  dpiErrorInfo info;
+  unsigned char *ptr;
+  dpiLobPiece piece;
+  int status;
+
+  while (1) {
+    enif_mutex_lock(writer->lock);
+    while (writer->produced - writer->written < 2 && !writer->closing &&
+        !writer->aborting)
+      enif_cond_wait(writer->cond, writer->lock);
+    if (writer->aborting) {
+      enif_mutex_unlock(writer->lock);
+      if (open)
+        dpiConn_breakExecution(writer->conn);
+      enif_mutex_lock(writer->lock);
+      writer->failed = 1;
+      writer->finished = 1;
+      enif_mutex_unlock(writer->lock);
+      break;
+    }
+    if (writer->produced == writer->written) {
+      writer->finished = 1;
+      enif_cond_broadcast(writer->cond);
+      enif_mutex_unlock(writer->lock);
+      break;
+    }
+    slot = &writer->slots[writer->written % LOB_WRITER_SLOTS];
+    first = (writer->written == 0);
+    last = (writer->closing && writer->produced - writer->written == 1);
+    enif_mutex_unlock(writer->lock);
+
+    if (first && last) {
+      status = dpiLob_writeBytes(writer->lob, 1,
+          (const char*) slot->data.data, slot->data.size);
+    } else {
+      piece = first ? DPI_LOB_PIECE_FIRST :
+          (last ? DPI_LOB_PIECE_LAST : DPI_LOB_PIECE_NEXT);
+      status = dpiLob_writePiece(writer->lob, 1,
+          (const char*) slot->data.data, slot->data.size, piece);
+      open = (status == DPI_SUCCESS && !last);
+    }
+    if (status < 0) {
+      dpiContext_getError(conn_context(), &info);
+      ptr = enif_make_new_binary(writer->errorEnv, info.messageLength,
+          &writer->error);
+      memcpy(ptr, info.message, info.messageLength);
+      if (!(first && last))
+        dpiConn_breakExecution(writer->conn);
+    }
+
+    enif_mutex_lock(writer->lock);
+    enif_clear_env(slot->env);
+    writer->written++;
+    if (status < 0) {
+      writer->failed = 1;
+      writer->finished = 1;
+    } else if (last) {
+      writer->finished = 1;
+    }
+    enif_cond_broadcast(writer->cond);
+    enif_mutex_unlock(writer->lock);
+    if (writer->finished)
+      break;
+  }
+  return NULL;
+}
+
+
+// Libera a conexão para as outras operações e solta a referência a ela.
+static void lob_writer_release_conn(conn_resource *connRes)
+{
+  if (connRes) {
+    atomic_store(&connRes->busy, 0);
+    enif_release_resource(connRes);
+  }
+}
+
+
+// Executada pela thread de limpeza (ou direto, se a thread de escrita não
+// chegou a ser criada): espera a escrita terminar e libera o LOB e a
+// conexão.
+static void lob_writer_free(void *arg)
+{
+  lob_writer *writer = arg;
+  int i;
+
+  if (writer->started)
+    enif_thread_join(writer->thread, NULL);
+  if (writer->lob)
+    dpiLob_release(writer->lob);
+  lob_writer_release_conn(writer->connRes);
+  for (i = 0; i < LOB_WRITER_SLOTS; i++) {
+    if (writer->slots[i].env)
+      enif_free_env(writer->slots[i].env);
+  }
+  if (writer->errorEnv)
+    enif_free_env(writer->errorEnv);
+  if (writer->cond)
+    enif_cond_destroy(writer->cond);
+  if (writer->lock)
+    enif_mutex_destroy(writer->lock);
+  enif_free(writer);
+}
+
+
+// Destrutor: sem lob_writer_close as partes na fila são descartadas e a
+// escrita em aberto é interrompida pela própria thread de escrita.
+static void lob_writer_dtor(ErlNifEnv *env, void *obj)
+{
+  lob_writer_resource *res = obj;
+  lob_writer *writer = res->writer;
+
+  if (!writer)
+    return;
+  if (writer->started) {
+    enif_mutex_lock(writer->lock);
+    writer->aborting = 1;
+    enif_cond_broadcast(writer->cond);
+    enif_mutex_unlock(writer->lock);
+  }
+  cleanup_schedule(lob_writer_free, writer);
+}
+
+
+int lob_load(ErlNifEnv *env)
+{
+  lob_reader_type = enif_open_resource_type(env, NULL, "oracle_nif_lob_reader",
+      lob_reader_dtor, ERL_NIF_RT_CREATE, NULL);
+  lob_writer_type = enif_open_resource_type(env, NULL, "oracle_nif_lob_writer",
+      lob_writer_dtor, ERL_NIF_RT_CREATE, NULL);
+  if (!lob_reader_type || !lob_writer_type)
+    return -1;
+  atom_ok = enif_make_atom(env, "ok");
+  atom_error = enif_make_atom(env, "error");
+  atom_done = enif_make_atom(env, "done");
+  atom_nil = enif_make_atom(env, "nil");
+  return 0;
+}
+
+
+// {:error, msg} para uma mensagem fixa
+static ERL_NIF_TERM lob_make_error(ErlNifEnv *env, const char *message)
+{
+  ERL_NIF_TERM term;
+  size_t length = strlen(message);
+
+  memcpy(enif_make_new_binary(env, length, &term), message, length);
+  return enif_make_tuple2(env, atom_error, term);
+}
+
+
+// Termo para os primeiros length bytes do binário, que passa a pertencer ao
+// termo. O binário é reduzido ao tamanho lido; se o enif_realloc_binary
+// falhar, o termo é um sub-binário do binário inteiro.
+static ERL_NIF_TERM lob_make_binary(ErlNifEnv *env, ErlNifBinary *data,
+    size_t length)
+{
+  ERL_NIF_TERM term;
+
+  if (length == data->size || enif_realloc_binary(data, length))
+    return enif_make_binary(env, data);
+  term = enif_make_binary(env, data);
+  return enif_make_sub_binary(env, term, 0, length);
+}
+
+
+// Executa a consulta e guarda o LOB da primeira coluna da primeira linha
+// (NULL se o valor for nulo) e o tipo da coluna.
+static ERL_NIF_TERM lob_query(ErlNifEnv *env, dpiConn *conn,
+    ErlNifBinary *sql, dpiLob **lob, dpiOracleTypeNum *oracleTypeNum)
+{
+  dpiNativeTypeNum nativeTypeNum;
+  uint32_t numColumns, bufferRowIndex;
+  ERL_NIF_TERM result = 0;
+  dpiQueryInfo info;
+  dpiStmt *stmt;
+  dpiData *data;
+  int found;
+
+  *lob = NULL;
+  if (dpiConn_prepareStmt(conn, 0, (const char*) sql->data, sql->size, NULL,
+      0, &stmt) < 0)
+    return conn_make_error(env);
+  if (dpiStmt_execute(stmt, DPI_MODE_EXEC_DEFAULT, &numColumns) < 0 ||
+      dpiStmt_getQueryInfo(stmt, 1, &info) < 0 ||
+      dpiStmt_fetch(stmt, &found, &bufferRowIndex) < 0 ||
+      (found && dpiStmt_getQueryValue(stmt, 1, &nativeTypeNum, &data) < 0))
+    result = conn_make_error(env);
+  else if (!found)
+    result = lob_make_error(env, "query returned no rows");
+  else if (nativeTypeNum != DPI_NATIVE_TYPE_LOB)
+    result = lob_make_error(env, "first column of query is not a LOB");
+  else if (!data->isNull) {
+    dpiLob_addRef(data->value.asLOB);
+    *lob = data->value.asLOB;
+    *oracleTypeNum = info.oracleTypeNum;
+  }
+  dpiStmt_release(stmt);
+  return result;
+}
+
+
+// Prepara a leitura: tamanho das partes e dos binários e, para BFILE, o
+// arquivo aberto uma única vez (o dpiLob_readBytes abriria e fecharia o
+// arquivo a cada parte). Abrir um CLOB ou BLOB só custaria idas ao banco.
+static int lob_reader_start(lob_reader *reader,
+    dpiOracleTypeNum oracleTypeNum)
+{
+  uint32_t chunkSize;
+  int isOpen;
+
+  if (dpiLob_getSize(reader->lob, &reader->size) < 0 ||
+      dpiLob_getChunkSize(reader->lob, &chunkSize) < 0)
+    return DPI_FAILURE;
+  if (reader->size == 0) {
+    reader->finished = 1;
+    return DPI_SUCCESS;
+  }
+  if (chunkSize == 0)
+    chunkSize = 1;
+  reader->pieceAmount = (LOB_READER_PIECE_SIZE / chunkSize) * chunkSize;
+  if (reader->pieceAmount == 0)
+    reader->pieceAmount = chunkSize;
+  if (dpiLob_getBufferSize(reader->lob, reader->pieceAmount,
+      &reader->bufferSize) < 0)
+    return DPI_FAILURE;
+  if (oracleTypeNum == DPI_ORACLE_TYPE_BFILE) {
+    if (dpiLob_getIsResourceOpen(reader->lob, &isOpen) < 0)
+      return DPI_FAILURE;
+    if (!isOpen && dpiLob_openResource(reader->lob) == DPI_SUCCESS)
+      reader->openedResource = 1;
+  }
+  reader->offset = 1;
+  if (enif_thread_create("oracle_nif_lob_reader", &reader->thread,
+      lob_reader_run, reader, NULL) != 0)
+    return DPI_FAILURE;
+  reader->started = 1;
+  return DPI_SUCCESS;
+}
+
+
+// lob_stream_open(conn, sql) -> {:ok, leitor} | {:error, msg}
+// A consulta deve retornar o LOB na primeira coluna; só a primeira linha é
+// usada. A leitura antecipada começa imediatamente.
+ERL_NIF_TERM lob_stream_open(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  dpiOracleTypeNum oracleTypeNum;
+  lob_reader_resource *res;
+  lob_reader *reader;
+  ErlNifBinary sql;
+  ERL_NIF_TERM term;
+  dpiConn *conn;
+  dpiLob *lob;
+  int i;
+
+  if (!conn_get_conn(env, argv[0], &conn) ||
+      !enif_inspect_binary(env, argv[1], &sql))
+    return enif_make_badarg(env);
+  term = lob_query(env, conn, &sql, &lob, &oracleTypeNum);
+  if (term)
+    return term;
+
+  res = enif_alloc_resource(lob_reader_type, sizeof(lob_reader_resource));
+  if (!res) {
+    if (lob)
+      dpiLob_release(lob);
+    return enif_make_badarg(env);
+  }
+  res->reader = NULL;
+  res->callLock = enif_mutex_create("oracle_nif_lob_reader_call");
+  reader = enif_alloc(sizeof(lob_reader));
+  if (!res->callLock || !reader) {
+    if (reader)
+      enif_free(reader);
+    if (lob)
+      dpiLob_release(lob);
+    enif_release_resource(res);
+    return enif_make_badarg(env);
+  }
+  memset(reader, 0, sizeof(lob_reader));
+  reader->lob = lob;
+  reader->lock = enif_mutex_create("oracle_nif_lob_reader_lock");
+  reader->cond = enif_cond_create("oracle_nif_lob_reader_cond");
+  for (i = 0; i < LOB_READER_SLOTS; i++)
+    reader->slots[i].env = enif_alloc_env();
+  if (!reader->lock || !reader->cond || !reader->slots[0].env ||
+      !reader->slots[1].env) {
+    lob_reader_free(reader);
+    enif_release_resource(res);
+    return enif_make_badarg(env);
+  }
+  if (!lob)
+    reader->finished = 1;
+  else if (lob_reader_start(reader, oracleTypeNum) < 0) {
+    term = conn_make_error(env);
+    lob_reader_free(reader);
+    enif_release_resource(res);
+    return term;
+  }
+  res->reader = reader;
+
+  term = enif_make_resource(env, res);
+  enif_release_resource(res);
+  return enif_make_tuple2(env, atom_ok, term);
+}
+
+
+// lob_stream_next(leitor) -> {:ok, binário} | :done | {:error, msg}
+ERL_NIF_TERM lob_stream_next(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  lob_reader_resource *res;
+  lob_reader_slot *slot;
+  lob_reader *reader;
+  ERL_NIF_TERM result;
+
+  if (!enif_get_resource(env, argv[0], lob_reader_type, (void**) &res))
+    return enif_make_badarg(env);
+
+  enif_mutex_lock(res->callLock);
+  reader = res->reader;
+  if (!reader) {
+    enif_mutex_unlock(res->callLock);
+    return atom_done;
+  }
+  enif_mutex_lock(reader->lock);
+  while (reader->started && reader->produced == reader->consumed &&
+      !reader->finished)
+    enif_cond_wait(reader->cond, reader->lock);
+  if (reader->produced == reader->consumed) {
+    enif_mutex_unlock(reader->lock);
+    enif_mutex_unlock(res->callLock);
+    return atom_done;
+  }
+  slot = &reader->slots[reader->consumed % LOB_READER_SLOTS];
+  enif_mutex_unlock(reader->lock);
+
+  if (slot->status == DPI_SUCCESS) {
+    result = lob_make_binary(env, &slot->data, slot->length);
+    result = enif_make_tuple2(env, atom_ok, result);
+    slot->allocated = 0;
+  } else {
+    result = enif_make_tuple2(env, atom_error,
+        enif_make_copy(env, slot->error));
+  }
+
+  enif_mutex_lock(reader->lock);
+  reader->consumed++;
+  enif_cond_broadcast(reader->cond);
+  enif_mutex_unlock(reader->lock);
+  enif_mutex_unlock(res->callLock);
+  return result;
+}
+
+
+// lob_stream_close(leitor) -> :ok; o LOB é liberado pela thread de limpeza,
+// sem esperar o GC
+ERL_NIF_TERM lob_stream_close(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  lob_reader_resource *res;
+
+  if (!enif_get_resource(env, argv[0], lob_reader_type, (void**) &res))
+    return enif_make_badarg(env);
+  enif_mutex_lock(res->callLock);
+  if (res->reader) {
+    lob_reader_stop(res->reader);
+    res->reader = NULL;
+  }
+  enif_mutex_unlock(res->callLock);
+  return atom_ok;
+}
+
+
+// lob_read(conn, sql) -> {:ok, binário | nil} | {:error, msg}
+// Lê o LOB inteiro numa única chamada, direto no binário retornado.
+ERL_NIF_TERM lob_read(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  uint64_t size, bufferSize, length;
+  dpiOracleTypeNum oracleTypeNum;
+  dpiConn *conn;
+  ErlNifBinary sql, data;
+  ERL_NIF_TERM term;
+  dpiLob *lob;
+
+  if (!conn_get_conn(env, argv[0], &conn) ||
+      !enif_inspect_binary(env, argv[1], &sql))
+    return enif_make_badarg(env);
+  term = lob_query(env, conn, &sql, &lob, &oracleTypeNum);
+  if (term)
+    return term;
+  if (!lob)
+    return enif_make_tuple2(env, atom_ok, atom_nil);
+  if (dpiLob_getSize(lob, &size) < 0 ||
+      dpiLob_getBufferSize(lob, size, &bufferSize) < 0) {
+    term = conn_make_error(env);
+    dpiLob_release(lob);
+    return term;
+  }
+  if (!enif_alloc_binary(bufferSize, &data)) {
+    dpiLob_release(lob);
+    return lob_make_error(env, LOB_NO_MEMORY);
+  }
+  length = bufferSize;
+  if (size > 0 && dpiLob_readBytes(lob, 1, size, (char*) data.data,
+      &length) < 0) {
+    term = conn_make_error(env);
+    enif_release_binary(&data);
+    dpiLob_release(lob);
+    return term;
+  }
+  dpiLob_release(lob);
+  if (size == 0)
+    length = 0;
+  return enif_make_tuple2(env, atom_ok, lob_make_binary(env, &data, length));
+}
+
+
+// lob_writer_open(conn, sql) -> {:ok, escritor} | {:error, msg}
+// A consulta deve retornar na primeira coluna o LOB a gravar, já bloqueado
+// (SELECT ... FOR UPDATE); o conteúdo atual é descartado. Até o
+// lob_writer_close, os outros NIFs recusam a conexão (badarg).
+ERL_NIF_TERM lob_writer_open(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  dpiOracleTypeNum oracleTypeNum;
+  lob_writer_resource *res;
+  conn_resource *connRes;
+  lob_writer *writer;
+  ErlNifBinary sql;
+  ERL_NIF_TERM term;
+  dpiConn *conn;
+  int i, idle = 0;
+  dpiLob *lob;
+
+  if (!conn_get_resource(env, argv[0], &connRes) ||
+      !enif_inspect_binary(env, argv[1], &sql) ||
+      (conn = atomic_load(&connRes->conn)) == NULL ||
+      !atomic_compare_exchange_strong(&connRes->busy, &idle, 1))
+    return enif_make_badarg(env);
+  term = lob_query(env, conn, &sql, &lob, &oracleTypeNum);
+  if (!term && !lob)
+    term = lob_make_error(env, "LOB to write is null");
+  if (!term && dpiLob_trim(lob, 0) < 0) {
+    term = conn_make_error(env);
+    dpiLob_release(lob);
+  }
+  if (term) {
+    atomic_store(&connRes->busy, 0);
+    return term;
+  }
+
+  res = enif_alloc_resource(lob_writer_type, sizeof(lob_writer_resource));
+  writer = enif_alloc(sizeof(lob_writer));
+  if (!res || !writer) {
+    if (res)
+      enif_release_resource(res);
+    if (writer)
+      enif_free(writer);
+    dpiLob_release(lob);
+    atomic_store(&connRes->busy, 0);
+    return enif_make_badarg(env);
+  }
+  res->writer = NULL;
+  memset(writer, 0, sizeof(lob_writer));
+  enif_keep_resource(connRes);
+  writer->connRes = connRes;
+  writer->conn = conn;
+  writer->lob = lob;
+  writer->lock = enif_mutex_create("oracle_nif_lob_writer_lock");
+  writer->cond = enif_cond_create("oracle_nif_lob_writer_cond");
+  writer->errorEnv = enif_alloc_env();
+  for (i = 0; i < LOB_WRITER_SLOTS; i++) {
+    writer->slots[i].env = enif_alloc_env();
+    if (!writer->slots[i].env)
+      break;
+  }
+  if (i < LOB_WRITER_SLOTS || !writer->lock || !writer->cond ||
+      !writer->errorEnv || enif_thread_create("oracle_nif_lob_writer",
+          &writer->thread, lob_writer_run, writer, NULL) != 0) {
+    lob_writer_free(writer);
+    enif_release_resource(res);
+    return enif_make_badarg(env);
+  }
+  writer->started = 1;
+  res->writer = writer;
+
+  term = enif_make_resource(env, res);
+  enif_release_resource(res);
+  return enif_make_tuple2(env, atom_ok, term);
+}
+
+
+// lob_writer_write(escritor, binário) -> :ok | {:error, msg}
+// Espera enquanto houver LOB_WRITER_SLOTS partes na fila.
+ERL_NIF_TERM lob_writer_write(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  lob_writer_resource *res;
+  lob_writer_slot *slot;
+  lob_writer *writer;
+  ErlNifBinary data;
+  ERL_NIF_TERM copy;
+
+  if (!enif_get_resource(env, argv[0], lob_writer_type, (void**) &res) ||
+      !enif_inspect_binary(env, argv[1], &data))
+    return enif_make_badarg(env);
+  if (data.size == 0)
+    return atom_ok;
+
+  writer = res->writer;
+  enif_mutex_lock(writer->lock);
+  while (!writer->finished && !writer->closing &&
+      writer->produced - writer->written >= LOB_WRITER_SLOTS)
+    enif_cond_wait(writer->cond, writer->lock);
+  if (writer->failed) {
+    copy = enif_make_tuple2(env, atom_error,
+        enif_make_copy(env, writer->error));
+    enif_mutex_unlock(writer->lock);
+    return copy;
+  }
+  if (writer->finished || writer->closing) {
+    enif_mutex_unlock(writer->lock);
+    return enif_make_badarg(env);
+  }
+  slot = &writer->slots[writer->produced % LOB_WRITER_SLOTS];
+  copy = enif_make_copy(slot->env, argv[1]);
+  enif_inspect_binary(slot->env, copy, &slot->data);
+  writer->produced++;
+  enif_cond_broadcast(writer->cond);
+  enif_mutex_unlock(writer->lock);
+  return atom_ok;
+}
+
+
+// lob_writer_close(escritor) -> :ok | {:error, msg}; grava o que estiver na
+// fila, termina a escrita e devolve a conexão às outras operações
+ERL_NIF_TERM lob_writer_close(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  lob_writer_resource *res;
+  conn_resource *connRes;
+  lob_writer *writer;
+  ERL_NIF_TERM result;
+
+  if (!enif_get_resource(env, argv[0], lob_writer_type, (void**) &res))
+    return enif_make_badarg(env);
+  writer = res->writer;
+  enif_mutex_lock(writer->lock);
+  writer->closing = 1;
+  enif_cond_broadcast(writer->cond);
+  while (!writer->finished)
+    enif_cond_wait(writer->cond, writer->lock);
+  connRes = writer->connRes;
+  writer->connRes = NULL;
+  result = writer->failed ? enif_make_tuple2(env, atom_error,
+      enif_make_copy(env, writer->error)) : atom_ok;
+  enif_mutex_unlock(writer->lock);
+  lob_writer_release_conn(connRes);
+  return result;
+}
@@ -0,0 +1,23 @@
+#ifndef DPILOB_NIF_H
+#define DPILOB_NIF_H
+
+#include <erl_nif.h>
+#include "dpi.h"
+
+int lob_load(ErlNifEnv *env);
+
+ERL_NIF_TERM lob_stream_open(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM lob_stream_next(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM lob_stream_close(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM lob_read(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM lob_writer_open(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM lob_writer_write(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM lob_writer_close(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+
+#endif
@@ -1605,16 +1605,17 @@ int dpiOci__lobFlushBuffer(dpiLob *lob, dpiError *error)
 // dpiOci__lobFreeTemporary() [INTERNAL]
 //   Wrapper for OCILobFreeTemporary().
 //-----------------------------------------------------------------------------
-int dpiOci__lobFreeTemporary(dpiLob *lob, int checkError, dpiError *error)
+int dpiOci__lobFreeTemporary(dpiConn *conn, void *locator, int checkError,
+        dpiError *error)
 {
     int status;
 
     DPI_OCI_LOAD_SYMBOL("OCILobFreeTemporary",
             dpiOciSymbols.fnLobFreeTemporary)
-    status = (*dpiOciSymbols.fnLobFreeTemporary)(lob->conn->handle,
-            error->handle, lob->locator);
+    status = (*dpiOciSymbols.fnLobFreeTemporary)(conn->handle,
+            error->handle, locator);
     if (checkError)
-        return dpiError__check(error, status, lob->conn, "free temporary LOB");
+        return dpiError__check(error, status, conn, "free temporary LOB");
     return DPI_SUCCESS;
 }
 
@@ -1758,22 +1759,26 @@ int dpiOci__lobTrim2(dpiLob *lob, uint64_t newLength, dpiError *error)
 
 //-----------------------------------------------------------------------------
 // dpiOci__lobWrite2() [INTERNAL]
-//   Wrapper for OCILobWrite2().
+//   Wrapper for OCILobWrite2(). When writing piecewise, the amount is passed
+// as zero with the first piece so that OCI uses polling mode and keeps
+// accepting pieces until the last one; OCI_NEED_DATA is returned until then.
 //-----------------------------------------------------------------------------
 int dpiOci__lobWrite2(dpiLob *lob, uint64_t offset, const char *value,
-        uint64_t valueLength, dpiError *error)
+        uint64_t valueLength, uint8_t piece, dpiError *error)
 {
-    uint64_t lengthInBytes = valueLength, lengthInChars = 0;
+    uint64_t lengthInBytes, lengthInChars = 0;
     uint16_t charsetId;
     int status;
 
     DPI_OCI_LOAD_SYMBOL("OCILobWrite2", dpiOciSymbols.fnLobWrite2)
+    lengthInBytes = (piece == DPI_OCI_ONE_PIECE) ? valueLength : 0;
     charsetId = (lob->type->charsetForm == DPI_SQLCS_NCHAR) ?
             lob->env->ncharsetId : lob->env->charsetId;
     status = (*dpiOciSymbols.fnLobWrite2)(lob->conn->handle, error->handle,
             lob->locator, &lengthInBytes, &lengthInChars, offset, (void*) value,
-            valueLength, DPI_OCI_ONE_PIECE, NULL, NULL, charsetId,
-            lob->type->charsetForm);
+            valueLength, piece, NULL, NULL, charsetId, lob->type->charsetForm);
+    if (status == DPI_OCI_NEED_DATA)
+        return DPI_SUCCESS;
     return dpiError__check(error, status, lob->conn, "write to LOB");
 }
 
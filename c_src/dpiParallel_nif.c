@@ -0,0 +1,900 @@
+// dpiParallel_nif.c
+// Execução de várias consultas independentes ao mesmo tempo. Cada thread
+// obtém a sua própria conexão do pool e vai pegando a próxima consulta da
+// lista até que todas tenham sido executadas; o tempo total fica próximo ao
+// da consulta mais lenta e não à soma de todas. O parallel_scan lê uma
+// tabela dividida em faixas de ROWID da mesma forma, mas entrega as linhas
+// de cada faixa ao processo assim que ela termina.
+
+#include <stdio.h>
+#include <string.h>
+#include "dpiParallel_nif.h"
+#include "dpiCleanup_nif.h"
+#include "dpiConn_nif.h"
+#include "dpiData_nif.h"
+#include "dpiPool_nif.h"
+
+typedef struct {
+  dpiNativeTypeNum nativeTypeNum;
+  dpiData data;
+} parallel_bind;
+
+typedef struct {
+  ErlNifBinary sql;
+  uint32_t numBinds;
+  parallel_bind *binds;
+  ERL_NIF_TERM result;
+  int done;
+} parallel_item;
+
+typedef struct {
+  dpiPool *pool;
+  ErlNifMutex *lock;
+  unsigned numItems;
+  unsigned nextItem;
+  parallel_item *items;
+} parallel_job;
+
+typedef struct {
+  parallel_job *job;
+  ErlNifTid thread;
+  ErlNifEnv *env;
+  ERL_NIF_TERM error;
+  int started;
+  int failed;
+} parallel_worker;
+
+// nomes sem aspas do Oracle e ROWIDs em texto (18 caracteres)
+#define PARALLEL_MAX_NAME_SIZE 128
+#define PARALLEL_MAX_ROWID_SIZE 32
+
+typedef struct {
+  char rowids[2][PARALLEL_MAX_ROWID_SIZE];
+  uint32_t lengths[2];
+  parallel_bind binds[2];
+} parallel_chunk;
+
+typedef struct parallel_scan_state parallel_scan_state;
+
+typedef struct {
+  parallel_scan_state *scan;
+  ErlNifTid thread;
+  ErlNifEnv *env;
+  int started;
+} parallel_scan_worker;
+
+// Estado de uma leitura em faixas; fica fora do recurso porque os workers
+// podem continuar rodando depois que o recurso é destruído.
+struct parallel_scan_state {
+  dpiPool *pool;
+  ErlNifMutex *lock;
+  ErlNifCond *cond;
+  ErlNifPid pid;
+  ErlNifEnv *refEnv;
+  ERL_NIF_TERM ref;
+  char *sql;
+  size_t sqlLength;
+  const char *owner;
+  uint32_t ownerLength;
+  const char *table;
+  uint32_t tableLength;
+  parallel_chunk *chunks;
+  parallel_item *items;
+  unsigned numChunks;
+  unsigned nextChunk;
+  unsigned acked;
+  unsigned window;
+  parallel_scan_worker *workers;
+  unsigned numWorkers;
+  unsigned numRunning;
+  int stopping;
+};
+
+typedef struct {
+  ErlNifMutex *lock;
+  parallel_scan_state *scan;
+} parallel_scan_resource;
+
+static ErlNifResourceType *parallel_scan_type;
+static ERL_NIF_TERM atom_ok;
+static ERL_NIF_TERM atom_error;
+static ERL_NIF_TERM atom_nil;
+static ERL_NIF_TERM atom_done;
+
+static void parallel_scan_dtor(ErlNifEnv *env, void *obj);
+
+
+int parallel_load(ErlNifEnv *env)
+{
+  parallel_scan_type = enif_open_resource_type(env, NULL,
+      "oracle_nif_parallel_scan", parallel_scan_dtor, ERL_NIF_RT_CREATE,
+      NULL);
+  if (!parallel_scan_type)
+    return -1;
+  atom_done = enif_make_atom(env, "done");
+  atom_ok = enif_make_atom(env, "ok");
+  atom_error = enif_make_atom(env, "error");
+  atom_nil = enif_make_atom(env, "nil");
+  return 0;
+}
+
+
+// Converte os valores a associar: inteiros, floats, binários e nil. Os
+// binários continuam pertencendo ao processo que chamou o NIF, que fica
+// bloqueado até o fim das consultas.
+static int parallel_get_binds(ErlNifEnv *env, ERL_NIF_TERM list,
+    parallel_item *item)
+{
+  ERL_NIF_TERM head;
+  parallel_bind *bind;
+  ErlNifBinary value;
+  unsigned length;
+
+  if (!enif_get_list_length(env, list, &length))
+    return 0;
+  item->numBinds = length;
+  if (length == 0)
+    return 1;
+  item->binds = enif_alloc(length * sizeof(parallel_bind));
+  if (!item->binds)
+    return 0;
+  memset(item->binds, 0, length * sizeof(parallel_bind));
+  for (bind = item->binds; enif_get_list_cell(env, list, &head, &list);
+      bind++) {
+    if (enif_get_int64(env, head, (ErlNifSInt64*) &bind->data.value.asInt64))
+      bind->nativeTypeNum = DPI_NATIVE_TYPE_INT64;
+    else if (enif_get_double(env, head, &bind->data.value.asDouble))
+      bind->nativeTypeNum = DPI_NATIVE_TYPE_DOUBLE;
+    else if (enif_inspect_binary(env, head, &value)) {
+      bind->nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+      bind->data.value.asBytes.ptr = (char*) value.data;
+      bind->data.value.asBytes.length = value.size;
+    } else if (enif_is_identical(head, atom_nil)) {
+      bind->nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+      bind->data.isNull = 1;
+    } else return 0;
+  }
+  return 1;
+}
+
+
+// Cada consulta é um SQL ou uma tupla {SQL, lista de valores}.
+static int parallel_get_item(ErlNifEnv *env, ERL_NIF_TERM term,
+    parallel_item *item)
+{
+  const ERL_NIF_TERM *elements;
+  int arity;
+
+  if (enif_inspect_binary(env, term, &item->sql))
+    return 1;
+  if (!enif_get_tuple(env, term, &arity, &elements) || arity != 2 ||
+      !enif_inspect_binary(env, elements[0], &item->sql))
+    return 0;
+  return parallel_get_binds(env, elements[1], item);
+}
+
+
+// Executa uma consulta e devolve {:ok, linhas} | {:error, msg}, com os
+// termos criados no ambiente da thread.
+static ERL_NIF_TERM parallel_execute(ErlNifEnv *env, dpiConn *conn,
+    parallel_item *item)
+{
+  ERL_NIF_TERM result, rows;
+  uint32_t i, numColumns;
+  dpiStmt *stmt;
+
+  if (dpiConn_prepareStmt(conn, 0, (const char*) item->sql.data,
+      item->sql.size, NULL, 0, &stmt) < 0)
+    return conn_make_error(env);
+  for (i = 0; i < item->numBinds; i++) {
+    if (dpiStmt_bindValueByPos(stmt, i + 1, item->binds[i].nativeTypeNum,
+        &item->binds[i].data) < 0)
+      goto error;
+  }
+  if (dpiStmt_execute(stmt, DPI_MODE_EXEC_DEFAULT, &numColumns) < 0)
+    goto error;
+  rows = enif_make_list(env, 0);
+  if (numColumns > 0 && data_fetch_all(env, stmt, numColumns,
+      DPI_DEFAULT_FETCH_ARRAY_SIZE, &rows) < 0)
+    goto error;
+  result = enif_make_tuple2(env, atom_ok, rows);
+  goto done;
+
+error:
+  result = conn_make_error(env);
+done:
+  dpiStmt_release(stmt);
+  return result;
+}
+
+
+static void *parallel_run(void *arg)
+{
+  parallel_worker *worker = arg;
+  parallel_job *job = worker->job;
+  parallel_item *item;
+  dpiConn *conn;
+
+  if (dpiPool_acquireConnection(job->pool, NULL, 0, NULL, 0, NULL,
+      &conn) < 0) {
+    worker->error = conn_make_error(worker->env);
+    worker->failed = 1;
+    return NULL;
+  }
+  while (1) {
+    enif_mutex_lock(job->lock);
+    item = (job->nextItem < job->numItems) ?
+        &job->items[job->nextItem++] : NULL;
+    enif_mutex_unlock(job->lock);
+    if (!item)
+      break;
+    item->result = parallel_execute(worker->env, conn, item);
+    item->done = 1;
+  }
+  dpiConn_release(conn);
+  return NULL;
+}
+
+
+// {:error, msg} para uma mensagem fixa
+static ERL_NIF_TERM parallel_make_error(ErlNifEnv *env, const char *message)
+{
+  ERL_NIF_TERM term;
+  size_t length = strlen(message);
+
+  memcpy(enif_make_new_binary(env, length, &term), message, length);
+  return enif_make_tuple2(env, atom_error, term);
+}
+
+
+// Executa os itens do job em até pool->maxSessions threads e preenche
+// results com {:ok, linhas} | {:error, msg} de cada item, criados em env.
+static int parallel_run_job(ErlNifEnv *env, pool_resource *pool,
+    parallel_job *job, ERL_NIF_TERM *results)
+{
+  parallel_worker *workers;
+  unsigned i, numWorkers;
+  ERL_NIF_TERM error;
+
+  numWorkers = job->numItems;
+  if (numWorkers > pool->maxSessions)
+    numWorkers = pool->maxSessions;
+  job->pool = pool->pool;
+  job->nextItem = 0;
+  job->lock = enif_mutex_create("oracle_nif_parallel_lock");
+  workers = enif_alloc(numWorkers * sizeof(parallel_worker));
+  if (!job->lock || !workers) {
+    if (job->lock)
+      enif_mutex_destroy(job->lock);
+    if (workers)
+      enif_free(workers);
+    return -1;
+  }
+  memset(workers, 0, numWorkers * sizeof(parallel_worker));
+  for (i = 0; i < numWorkers; i++) {
+    workers[i].job = job;
+    workers[i].env = enif_alloc_env();
+    if (workers[i].env && enif_thread_create("oracle_nif_parallel",
+        &workers[i].thread, parallel_run, &workers[i], NULL) == 0)
+      workers[i].started = 1;
+  }
+  for (i = 0; i < numWorkers; i++) {
+    if (workers[i].started)
+      enif_thread_join(workers[i].thread, NULL);
+  }
+
+  // itens não executados recebem o erro de quem não obteve conexão
+  error = parallel_make_error(env, "no worker thread could be started");
+  for (i = 0; i < numWorkers; i++) {
+    if (workers[i].failed) {
+      error = enif_make_copy(env, workers[i].error);
+      break;
+    }
+  }
+  for (i = 0; i < job->numItems; i++)
+    results[i] = (job->items[i].done) ?
+        enif_make_copy(env, job->items[i].result) : error;
+
+  for (i = 0; i < numWorkers; i++) {
+    if (workers[i].env)
+      enif_free_env(workers[i].env);
+  }
+  enif_free(workers);
+  enif_mutex_destroy(job->lock);
+  return 0;
+}
+
+
+static void parallel_free_items(parallel_job *job)
+{
+  unsigned i;
+
+  for (i = 0; i < job->numItems; i++) {
+    if (job->items[i].binds)
+      enif_free(job->items[i].binds);
+  }
+  enif_free(job->items);
+}
+
+
+// parallel_query(pool, consultas) -> lista de {:ok, linhas} | {:error, msg},
+// na mesma ordem das consultas. São usadas até tantas conexões quanto o
+// máximo de sessões do pool.
+ERL_NIF_TERM parallel_query(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  ERL_NIF_TERM list, head, *results;
+  pool_resource *pool;
+  parallel_job job;
+  unsigned i;
+
+  memset(&job, 0, sizeof(job));
+  if (!pool_get_resource(env, argv[0], &pool) ||
+      !enif_get_list_length(env, argv[1], &job.numItems))
+    return enif_make_badarg(env);
+  if (job.numItems == 0)
+    return enif_make_list(env, 0);
+  job.items = enif_alloc(job.numItems * sizeof(parallel_item));
+  if (!job.items)
+    return enif_make_badarg(env);
+  memset(job.items, 0, job.numItems * sizeof(parallel_item));
+  list = argv[1];
+  for (i = 0; enif_get_list_cell(env, list, &head, &list); i++) {
+    if (!parallel_get_item(env, head, &job.items[i])) {
+      parallel_free_items(&job);
+      return enif_make_badarg(env);
+    }
+  }
+
+  results = enif_alloc(job.numItems * sizeof(ERL_NIF_TERM));
+  if (!results || parallel_run_job(env, pool, &job, results) < 0)
+    list = enif_make_badarg(env);
+  else list = enif_make_list_from_array(env, results, job.numItems);
+  if (results)
+    enif_free(results);
+  parallel_free_items(&job);
+  return list;
+}
+
+
+// Nome de tabela ou coluna: uma ou duas partes (dono.tabela) de letras,
+// dígitos, _, $ e #, começando por letra. O nome é copiado para quoted em
+// maiúsculas e entre aspas, exatamente como o Oracle resolve um nome sem
+// aspas; qualquer outro caractere é recusado, sem chance de injeção. Em
+// dot fica a posição do ponto em quoted (0 se não houver).
+static int parallel_quote_name(ErlNifBinary *name, int allowDot,
+    char *quoted, size_t *length, size_t *dot)
+{
+  size_t i, partLength = 0;
+  char c;
+
+  *dot = 0;
+  *length = 0;
+  quoted[(*length)++] = '"';
+  for (i = 0; i < name->size; i++) {
+    c = name->data[i];
+    if (c == '.' && allowDot && !*dot && partLength > 0) {
+      quoted[(*length)++] = '"';
+      *dot = (*length)++;
+      quoted[*dot] = '.';
+      quoted[(*length)++] = '"';
+      partLength = 0;
+      continue;
+    }
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+      c &= ~0x20;
+    else if (partLength == 0 || !((c >= '0' && c <= '9') || c == '_' ||
+        c == '$' || c == '#'))
+      return 0;
+    if (++partLength > PARALLEL_MAX_NAME_SIZE)
+      return 0;
+    quoted[(*length)++] = c;
+  }
+  if (partLength == 0)
+    return 0;
+  quoted[(*length)++] = '"';
+  return 1;
+}
+
+
+// Monta "select "A", "B" from "DONO"."TABELA" where rowid between ..." e
+// guarda dono e tabela (sem as aspas) para o DBMS_PARALLEL_EXECUTE.
+static int parallel_scan_build_sql(ErlNifEnv *env, ERL_NIF_TERM table,
+    ERL_NIF_TERM columns, parallel_scan_state *scan)
+{
+  static const char sqlWhere[] =
+      " where rowid between chartorowid(:1) and chartorowid(:2)";
+  size_t length, dot;
+  ErlNifBinary name;
+  ERL_NIF_TERM head;
+  unsigned numColumns;
+  char *ptr;
+
+  if (!enif_inspect_binary(env, table, &name) ||
+      !enif_get_list_length(env, columns, &numColumns) || numColumns == 0)
+    return 0;
+  scan->sql = enif_alloc(sizeof("select  from ") + sizeof(sqlWhere) +
+      name.size * 3 + 2 + numColumns * (PARALLEL_MAX_NAME_SIZE + 4));
+  if (!scan->sql)
+    return 0;
+  ptr = scan->sql;
+  memcpy(ptr, "select ", 7);
+  ptr += 7;
+  while (enif_get_list_cell(env, columns, &head, &columns)) {
+    if (!enif_inspect_binary(env, head, &name) ||
+        !parallel_quote_name(&name, 0, ptr, &length, &dot))
+      return 0;
+    ptr += length;
+    if (--numColumns > 0) {
+      memcpy(ptr, ", ", 2);
+      ptr += 2;
+    }
+  }
+  memcpy(ptr, " from ", 6);
+  ptr += 6;
+  enif_inspect_binary(env, table, &name);
+  if (!parallel_quote_name(&name, 1, ptr, &length, &dot))
+    return 0;
+
+  // sem dono, vale o schema corrente da sessão
+  if (dot) {
+    scan->owner = ptr + 1;
+    scan->ownerLength = dot - 2;
+    scan->table = ptr + dot + 2;
+  } else scan->table = ptr + 1;
+  scan->tableLength = ptr + length - 1 - scan->table;
+  ptr += length;
+  memcpy(ptr, sqlWhere, sizeof(sqlWhere) - 1);
+  ptr += sizeof(sqlWhere) - 1;
+  scan->sqlLength = ptr - scan->sql;
+  return 1;
+}
+
+
+// Prepara e executa o SQL associando por posição os valores de texto
+// (NULL quando o ponteiro é nulo); o dpiStmt fica com quem chamou.
+static int parallel_scan_execute(dpiConn *conn, const char *sql,
+    const char **values, const uint32_t *lengths, uint32_t numValues,
+    dpiStmt **stmt)
+{
+  uint32_t i, numColumns;
+  dpiData data;
+
+  *stmt = NULL;
+  if (dpiConn_prepareStmt(conn, 0, sql, strlen(sql), NULL, 0, stmt) < 0)
+    return DPI_FAILURE;
+  for (i = 0; i < numValues; i++) {
+    memset(&data, 0, sizeof(data));
+    data.isNull = !values[i];
+    data.value.asBytes.ptr = (char*) values[i];
+    data.value.asBytes.length = lengths[i];
+    if (dpiStmt_bindValueByPos(*stmt, i + 1, DPI_NATIVE_TYPE_BYTES,
+        &data) < 0)
+      return DPI_FAILURE;
+  }
+  return dpiStmt_execute(*stmt, DPI_MODE_EXEC_DEFAULT, &numColumns);
+}
+
+
+// Acrescenta a scan->chunks as faixas de ROWID do bloco de linhas buscado.
+static int parallel_scan_add_chunks(ErlNifEnv *env, parallel_scan_state *scan,
+    dpiStmt *stmt, uint32_t numRows, uint32_t *allocated, ERL_NIF_TERM *error)
+{
+  dpiNativeTypeNum nativeTypeNum;
+  parallel_chunk *temp;
+  dpiData *data;
+  uint32_t i, j;
+
+  if (scan->numChunks + numRows > *allocated) {
+    *allocated = (scan->numChunks + numRows) * 2;
+    temp = enif_realloc(scan->chunks, *allocated * sizeof(parallel_chunk));
+    if (!temp) {
+      *error = parallel_make_error(env, "out of memory");
+      return DPI_FAILURE;
+    }
+    scan->chunks = temp;
+  }
+  for (j = 0; j < 2; j++) {
+    if (dpiStmt_getQueryValue(stmt, j + 1, &nativeTypeNum, &data) < 0) {
+      *error = conn_make_error(env);
+      return DPI_FAILURE;
+    }
+    data -= numRows - 1;
+    for (i = 0; i < numRows; i++) {
+      if (data[i].isNull ||
+          data[i].value.asBytes.length > PARALLEL_MAX_ROWID_SIZE) {
+        *error = parallel_make_error(env, "unexpected ROWID in chunk");
+        return DPI_FAILURE;
+      }
+      memcpy(scan->chunks[scan->numChunks + i].rowids[j],
+          data[i].value.asBytes.ptr, data[i].value.asBytes.length);
+      scan->chunks[scan->numChunks + i].lengths[j] =
+          data[i].value.asBytes.length;
+    }
+  }
+  scan->numChunks += numRows;
+  return DPI_SUCCESS;
+}
+
+
+// Divide a tabela em faixas de ROWID de até chunkBlocks blocos com o
+// DBMS_PARALLEL_EXECUTE, que parte dos extents da tabela: cada faixa cobre
+// blocos contíguos e é lida sem passar pelos blocos das outras. A tarefa
+// criada no banco só serve para obter as faixas e é descartada em seguida.
+static int parallel_scan_chunks(ErlNifEnv *env, parallel_scan_state *scan,
+    dpiConn *conn, uint32_t chunkBlocks, ERL_NIF_TERM *error)
+{
+  static const char nameSql[] =
+      "select dbms_parallel_execute.generate_task_name from dual";
+  static const char createSql[] =
+      "begin "
+      "dbms_parallel_execute.create_task(:1); "
+      "dbms_parallel_execute.create_chunks_by_rowid(:1, "
+      "nvl(:2, sys_context('userenv', 'current_schema')), :3, false, "
+      "to_number(:4)); "
+      "end;";
+  static const char chunksSql[] =
+      "select rowidtochar(start_rowid), rowidtochar(end_rowid) "
+      "from user_parallel_execute_chunks where task_name = :1 "
+      "order by chunk_id";
+  static const char dropSql[] =
+      "begin dbms_parallel_execute.drop_task(:1); end;";
+  uint32_t lengths[4], bufferRowIndex, numRows, allocated = 0;
+  char name[PARALLEL_MAX_NAME_SIZE], blocks[16];
+  dpiNativeTypeNum nativeTypeNum;
+  int status, moreRows = 1;
+  const char *values[4];
+  dpiStmt *stmt;
+  dpiData *data;
+
+  // nome único para a tarefa, gerado pelo próprio banco
+  if (parallel_scan_execute(conn, nameSql, NULL, NULL, 0, &stmt) < 0 ||
+      dpiStmt_fetchRows(stmt, 1, &bufferRowIndex, &numRows, &moreRows) < 0 ||
+      dpiStmt_getQueryValue(stmt, 1, &nativeTypeNum, &data) < 0) {
+    *error = conn_make_error(env);
+    if (stmt)
+      dpiStmt_release(stmt);
+    return DPI_FAILURE;
+  }
+  values[0] = name;
+  lengths[0] = data->value.asBytes.length;
+  if (lengths[0] > PARALLEL_MAX_NAME_SIZE)
+    lengths[0] = PARALLEL_MAX_NAME_SIZE;
+  memcpy(name, data->value.asBytes.ptr, lengths[0]);
+  dpiStmt_release(stmt);
+
+  values[1] = scan->owner;
+  lengths[1] = scan->ownerLength;
+  values[2] = scan->table;
+  lengths[2] = scan->tableLength;
+  values[3] = blocks;
+  lengths[3] = snprintf(blocks, sizeof(blocks), "%u", chunkBlocks);
+  status = parallel_scan_execute(conn, createSql, values, lengths, 4, &stmt);
+  if (stmt) {
+    dpiStmt_release(stmt);
+    stmt = NULL;
+  }
+  if (status == DPI_SUCCESS)
+    status = parallel_scan_execute(conn, chunksSql, values, lengths, 1,
+        &stmt);
+  if (status < 0)
+    *error = conn_make_error(env);
+  while (status == DPI_SUCCESS && moreRows) {
+    status = dpiStmt_fetchRows(stmt, DPI_DEFAULT_FETCH_ARRAY_SIZE,
+        &bufferRowIndex, &numRows, &moreRows);
+    if (status < 0)
+      *error = conn_make_error(env);
+    else if (numRows > 0)
+      status = parallel_scan_add_chunks(env, scan, stmt, numRows,
+          &allocated, error);
+  }
+  if (stmt)
+    dpiStmt_release(stmt);
+
+  // a tarefa é descartada mesmo depois de um erro, que tem precedência
+  if (parallel_scan_execute(conn, dropSql, values, lengths, 1, &stmt) < 0 &&
+      status == DPI_SUCCESS) {
+    *error = conn_make_error(env);
+    status = DPI_FAILURE;
+  }
+  if (stmt)
+    dpiStmt_release(stmt);
+  return status;
+}
+
+
+// Executada pela thread de limpeza (ou direto, se as threads não chegaram
+// a ser criadas): espera os workers e libera a leitura.
+static void parallel_scan_free(void *arg)
+{
+  parallel_scan_state *scan = arg;
+  unsigned i;
+
+  for (i = 0; i < scan->numWorkers; i++) {
+    if (scan->workers[i].started)
+      enif_thread_join(scan->workers[i].thread, NULL);
+    if (scan->workers[i].env)
+      enif_free_env(scan->workers[i].env);
+  }
+  if (scan->workers)
+    enif_free(scan->workers);
+  if (scan->items)
+    enif_free(scan->items);
+  if (scan->chunks)
+    enif_free(scan->chunks);
+  if (scan->sql)
+    enif_free(scan->sql);
+  if (scan->pool)
+    dpiPool_release(scan->pool);
+  if (scan->refEnv)
+    enif_free_env(scan->refEnv);
+  if (scan->cond)
+    enif_cond_destroy(scan->cond);
+  if (scan->lock)
+    enif_mutex_destroy(scan->lock);
+  enif_free(scan);
+}
+
+
+// Interrompe a leitura sem esperar os workers: nenhuma mensagem nova é
+// enviada e a thread de limpeza libera tudo quando eles terminarem.
+static void parallel_scan_stop(parallel_scan_state *scan)
+{
+  enif_mutex_lock(scan->lock);
+  scan->stopping = 1;
+  enif_cond_broadcast(scan->cond);
+  enif_mutex_unlock(scan->lock);
+  cleanup_schedule(parallel_scan_free, scan);
+}
+
+
+// Envia {ref, msg} ao processo, a menos que a leitura tenha sido
+// interrompida; um erro interrompe também os outros workers. O enif_send
+// invalida os termos do ambiente, que é limpo em qualquer caso.
+static void parallel_scan_send(parallel_scan_state *scan, ErlNifEnv *env,
+    ERL_NIF_TERM msg, int failed)
+{
+  enif_mutex_lock(scan->lock);
+  if (!scan->stopping) {
+    enif_send(NULL, &scan->pid, env, enif_make_tuple2(env,
+        enif_make_copy(env, scan->ref), msg));
+    if (failed) {
+      scan->stopping = 1;
+      enif_cond_broadcast(scan->cond);
+    }
+  }
+  enif_clear_env(env);
+  enif_mutex_unlock(scan->lock);
+}
+
+
+// Cada worker lê faixas até que acabem, com a sua própria conexão do pool.
+// Um worker só pega uma faixa nova enquanto houver menos de scan->window
+// faixas lidas e ainda não confirmadas pelo parallel_scan_next. O último a
+// terminar envia {ref, :done}.
+static void *parallel_scan_run(void *arg)
+{
+  parallel_scan_worker *worker = arg;
+  parallel_scan_state *scan = worker->scan;
+  const ERL_NIF_TERM *tuple;
+  ERL_NIF_TERM result;
+  parallel_item *item;
+  dpiConn *conn;
+  int arity;
+
+  if (dpiPool_acquireConnection(scan->pool, NULL, 0, NULL, 0, NULL,
+      &conn) < 0) {
+    parallel_scan_send(scan, worker->env, conn_make_error(worker->env), 1);
+    conn = NULL;
+  }
+  while (conn) {
+    enif_mutex_lock(scan->lock);
+    while (!scan->stopping && scan->nextChunk < scan->numChunks &&
+        scan->nextChunk - scan->acked >= scan->window)
+      enif_cond_wait(scan->cond, scan->lock);
+    item = (!scan->stopping && scan->nextChunk < scan->numChunks) ?
+        &scan->items[scan->nextChunk++] : NULL;
+    enif_mutex_unlock(scan->lock);
+    if (!item)
+      break;
+    result = parallel_execute(worker->env, conn, item);
+    if (!enif_get_tuple(worker->env, result, &arity, &tuple) ||
+        !enif_is_identical(tuple[0], atom_ok)) {
+      parallel_scan_send(scan, worker->env, result, 1);
+      break;
+    }
+    parallel_scan_send(scan, worker->env, result, 0);
+  }
+  if (conn)
+    dpiConn_release(conn);
+
+  enif_mutex_lock(scan->lock);
+  if (--scan->numRunning == 0 && !scan->stopping)
+    enif_send(NULL, &scan->pid, worker->env, enif_make_tuple2(worker->env,
+        enif_make_copy(worker->env, scan->ref), atom_done));
+  enif_clear_env(worker->env);
+  enif_mutex_unlock(scan->lock);
+  return NULL;
+}
+
+
+// Cria um item por faixa (todos com o mesmo SQL, e portanto o mesmo cursor
+// em cache em cada conexão) e até maxSessions workers. As threads são
+// criadas com o lock seguro: se alguma falhar, nenhuma chega a enviar nada.
+static int parallel_scan_start(ErlNifEnv *env, parallel_scan_state *scan,
+    uint32_t maxSessions)
+{
+  parallel_chunk *chunk;
+  parallel_item *item;
+  unsigned i, j;
+
+  if (scan->numChunks == 0) {
+    enif_send(env, &scan->pid, NULL,
+        enif_make_tuple2(env, enif_make_copy(env, scan->ref), atom_done));
+    return 0;
+  }
+  scan->items = enif_alloc(scan->numChunks * sizeof(parallel_item));
+  scan->numWorkers = (scan->numChunks < maxSessions) ?
+      scan->numChunks : maxSessions;
+  scan->workers = enif_alloc(scan->numWorkers * sizeof(parallel_scan_worker));
+  if (!scan->items || !scan->workers) {
+    scan->numWorkers = 0;
+    return -1;
+  }
+  memset(scan->items, 0, scan->numChunks * sizeof(parallel_item));
+  memset(scan->workers, 0, scan->numWorkers * sizeof(parallel_scan_worker));
+  for (i = 0; i < scan->numChunks; i++) {
+    chunk = &scan->chunks[i];
+    item = &scan->items[i];
+    item->sql.data = (unsigned char*) scan->sql;
+    item->sql.size = scan->sqlLength;
+    item->numBinds = 2;
+    item->binds = chunk->binds;
+    for (j = 0; j < 2; j++) {
+      memset(&chunk->binds[j], 0, sizeof(parallel_bind));
+      chunk->binds[j].nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+      chunk->binds[j].data.value.asBytes.ptr = chunk->rowids[j];
+      chunk->binds[j].data.value.asBytes.length = chunk->lengths[j];
+    }
+  }
+
+  scan->window = scan->numWorkers * 2;
+  enif_mutex_lock(scan->lock);
+  for (i = 0; i < scan->numWorkers; i++) {
+    scan->workers[i].scan = scan;
+    scan->workers[i].env = enif_alloc_env();
+    if (!scan->workers[i].env || enif_thread_create("oracle_nif_scan",
+        &scan->workers[i].thread, parallel_scan_run, &scan->workers[i],
+        NULL) != 0)
+      break;
+    scan->workers[i].started = 1;
+    scan->numRunning++;
+  }
+  if (i < scan->numWorkers) {
+    scan->stopping = 1;
+    enif_cond_broadcast(scan->cond);
+  }
+  enif_mutex_unlock(scan->lock);
+  return (i < scan->numWorkers) ? -1 : 0;
+}
+
+
+static void parallel_scan_dtor(ErlNifEnv *env, void *obj)
+{
+  parallel_scan_resource *res = obj;
+
+  if (res->scan)
+    parallel_scan_stop(res->scan);
+  if (res->lock)
+    enif_mutex_destroy(res->lock);
+}
+
+
+// parallel_scan_open(pool, tabela, colunas, blocos por faixa) ->
+// {:ok, scan, ref} | {:error, msg}. A tabela é dividida em faixas de ROWID
+// e cada faixa é buscada por um dos workers; as linhas de cada faixa chegam
+// ao processo que chamou como {ref, {:ok, linhas}}, na ordem em que as
+// faixas terminam, e o fim como {ref, :done} (ou {ref, {:error, msg}}).
+ERL_NIF_TERM parallel_scan_open(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  parallel_scan_resource *res;
+  parallel_scan_state *scan;
+  ERL_NIF_TERM term = 0, ref;
+  unsigned chunkBlocks;
+  pool_resource *pool;
+  dpiConn *conn;
+  int status;
+
+  if (!pool_get_resource(env, argv[0], &pool) ||
+      !enif_get_uint(env, argv[3], &chunkBlocks) || chunkBlocks == 0)
+    return enif_make_badarg(env);
+  scan = enif_alloc(sizeof(parallel_scan_state));
+  if (!scan)
+    return enif_make_badarg(env);
+  memset(scan, 0, sizeof(parallel_scan_state));
+  scan->lock = enif_mutex_create("oracle_nif_scan_lock");
+  scan->cond = enif_cond_create("oracle_nif_scan_cond");
+  scan->refEnv = enif_alloc_env();
+  if (!scan->lock || !scan->cond || !scan->refEnv ||
+      !parallel_scan_build_sql(env, argv[1], argv[2], scan)) {
+    parallel_scan_free(scan);
+    return enif_make_badarg(env);
+  }
+  dpiPool_addRef(pool->pool);
+  scan->pool = pool->pool;
+  enif_self(env, &scan->pid);
+  ref = enif_make_ref(env);
+  scan->ref = enif_make_copy(scan->refEnv, ref);
+
+  if (dpiPool_acquireConnection(pool->pool, NULL, 0, NULL, 0, NULL,
+      &conn) < 0) {
+    parallel_scan_free(scan);
+    return conn_make_error(env);
+  }
+  status = parallel_scan_chunks(env, scan, conn, chunkBlocks, &term);
+  dpiConn_release(conn);
+  if (status < 0) {
+    parallel_scan_free(scan);
+    return term;
+  }
+
+  res = enif_alloc_resource(parallel_scan_type,
+      sizeof(parallel_scan_resource));
+  if (!res) {
+    parallel_scan_free(scan);
+    return enif_make_badarg(env);
+  }
+  memset(res, 0, sizeof(parallel_scan_resource));
+  res->lock = enif_mutex_create("oracle_nif_scan_resource_lock");
+  if (!res->lock || parallel_scan_start(env, scan, pool->maxSessions) < 0) {
+    cleanup_schedule(parallel_scan_free, scan);
+    enif_release_resource(res);
+    return parallel_make_error(env, "could not start the scan workers");
+  }
+  res->scan = scan;
+  term = enif_make_resource(env, res);
+  enif_release_resource(res);
+  return enif_make_tuple3(env, atom_ok, term, ref);
+}
+
+
+// parallel_scan_next(scan) -> :ok. Confirma que uma faixa recebida foi
+// tratada, liberando os workers para ler mais uma.
+ERL_NIF_TERM parallel_scan_next(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  parallel_scan_resource *res;
+
+  if (!enif_get_resource(env, argv[0], parallel_scan_type, (void**) &res))
+    return enif_make_badarg(env);
+  enif_mutex_lock(res->lock);
+  if (res->scan) {
+    enif_mutex_lock(res->scan->lock);
+    res->scan->acked++;
+    enif_cond_signal(res->scan->cond);
+    enif_mutex_unlock(res->scan->lock);
+  }
+  enif_mutex_unlock(res->lock);
+  return atom_ok;
+}
+
+
+// parallel_scan_close(scan) -> :ok. Depois dele nenhuma faixa nova é
+// enviada; as conexões voltam ao pool quando os workers terminarem a faixa
+// em andamento.
+ERL_NIF_TERM parallel_scan_close(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[])
+{
+  parallel_scan_resource *res;
+
+  if (!enif_get_resource(env, argv[0], parallel_scan_type, (void**) &res))
+    return enif_make_badarg(env);
+  enif_mutex_lock(res->lock);
+  if (res->scan) {
+    parallel_scan_stop(res->scan);
+    res->scan = NULL;
+  }
+  enif_mutex_unlock(res->lock);
+  return atom_ok;
+}
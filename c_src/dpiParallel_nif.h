@@ -0,0 +1,18 @@
+#ifndef DPIPARALLEL_NIF_H
+#define DPIPARALLEL_NIF_H
+
+#include <erl_nif.h>
+#include "dpi.h"
+
+int parallel_load(ErlNifEnv *env);
+
+ERL_NIF_TERM parallel_query(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM parallel_scan_open(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM parallel_scan_next(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM parallel_scan_close(ErlNifEnv *env, int argc,
+    const ERL_NIF_TERM argv[]);
+
+#endif
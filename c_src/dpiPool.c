@@ -16,6 +16,10 @@
 
 #include "dpiImpl.h"
 
+// forward declarations of internal functions only used in this file
+static void dpiPool__recordAcquire(dpiPool *pool, dpiConnCreateParams *params,
+        uint64_t startTime, int success, int32_t errorCode, dpiError *error);
+
 //-----------------------------------------------------------------------------
 // dpiPool__acquireConnection() [INTERNAL]
 //   Internal method used for acquiring a connection from a pool.
@@ -24,6 +28,7 @@ int dpiPool__acquireConnection(dpiPool *pool, const char *userName,
         uint32_t userNameLength, const char *password, uint32_t passwordLength,
         dpiConnCreateParams *params, dpiConn **conn, dpiError *error)
 {
+    uint64_t startTime;
     dpiConn *tempConn;
 
     // allocate new connection
@@ -32,12 +37,16 @@ int dpiPool__acquireConnection(dpiPool *pool, const char *userName,
         return DPI_FAILURE;
 
     // create the connection
+    startTime = dpiUtils__getMonotonicTime();
     if (dpiConn__get(tempConn, userName, userNameLength, password,
             passwordLength, pool->name, pool->nameLength, params, pool,
             error) < 0) {
+        dpiPool__recordAcquire(pool, params, startTime, 0,
+                error->buffer->code, error);
         dpiConn__free(tempConn, error);
         return DPI_FAILURE;
     }
+    dpiPool__recordAcquire(pool, params, startTime, 1, 0, error);
 
     *conn = tempConn;
     return DPI_SUCCESS;
@@ -172,6 +181,55 @@ static int dpiPool__getAttributeUint(dpiPool *pool, uint32_t attribute,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiPool__recordAcquire() [INTERNAL]
+//   Record the outcome of an acquire in the pool's statistics. The time spent
+// acquiring a new session is also counted as a session creation. The success
+// flag decides whether the acquire failed, since DPI-xxxx errors carry no
+// Oracle error code; the code is only used to tell timeouts apart (ORA-24457
+// and ORA-24496 mean that the wait for a free session timed out). Errors are
+// ignored here so that the outcome of the acquire itself is not changed.
+//-----------------------------------------------------------------------------
+static void dpiPool__recordAcquire(dpiPool *pool, dpiConnCreateParams *params,
+        uint64_t startTime, int success, int32_t errorCode, dpiError *error)
+{
+    dpiPoolMetrics *metrics = &pool->metrics;
+    uint64_t elapsed;
+    uint32_t bucket;
+
+    elapsed = dpiUtils__getMonotonicTime() - startTime;
+    for (bucket = 0; bucket < DPI_POOL_WAIT_BUCKETS - 1 &&
+            elapsed >= ((uint64_t) 1 << bucket); bucket++);
+
+    if (pool->env->threaded &&
+            dpiOci__threadMutexAcquire(pool->env, error) < 0)
+        return;
+    metrics->numAcquires++;
+    if (!success) {
+        metrics->numAcquireFailures++;
+        if (errorCode == 24457 || errorCode == 24496)
+            metrics->numAcquireTimeouts++;
+    }
+    metrics->acquireWaitTotal += elapsed;
+    if (elapsed > metrics->acquireWaitMax)
+        metrics->acquireWaitMax = elapsed;
+    metrics->acquireWaitBuckets[bucket]++;
+    if (success && params->outNewSession) {
+        metrics->numSessionsCreated++;
+        metrics->sessionCreateTotal += elapsed;
+        if (elapsed > metrics->sessionCreateMax)
+            metrics->sessionCreateMax = elapsed;
+    }
+    if (params->tagLength > 0) {
+        metrics->numTagRequests++;
+        if (success && params->outTagFound)
+            metrics->numTagMatches++;
+    }
+    if (pool->env->threaded)
+        dpiOci__threadMutexRelease(pool->env, error);
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiPool__setAttributeUint() [INTERNAL]
 //   Set the value of the OCI attribute as an unsigned integer.
@@ -387,6 +445,28 @@ int dpiPool_getMaxLifetimeSession(dpiPool *pool, uint32_t *value)
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiPool_getMetrics() [PUBLIC]
+//   Return a copy of the statistics gathered on acquires from the pool.
+//-----------------------------------------------------------------------------
+int dpiPool_getMetrics(dpiPool *pool, dpiPoolMetrics *metrics)
+{
+    dpiError error;
+
+    if (dpiPool__checkConnected(pool, __func__, &error) < 0)
+        return DPI_FAILURE;
+    DPI_CHECK_PTR_NOT_NULL(metrics)
+    if (pool->env->threaded &&
+            dpiOci__threadMutexAcquire(pool->env, &error) < 0)
+        return DPI_FAILURE;
+    memcpy(metrics, &pool->metrics, sizeof(dpiPoolMetrics));
+    if (pool->env->threaded &&
+            dpiOci__threadMutexRelease(pool->env, &error) < 0)
+        return DPI_FAILURE;
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiPool_getOpenCount() [PUBLIC]
 //   Return the pool's open count.
@@ -0,0 +1,251 @@
+// dpiPool_nif.c
+// Pool de sessões (dpiPool) exposto ao Elixir como recurso.
+
+#include <string.h>
+#include "dpiPool_nif.h"
+#include "dpiConn_nif.h"
+
+// Aquecimento do pool: cada thread abre uma sessão e só a devolve quando
+// todas as outras já abriram as suas, para que sejam sessões distintas.
+typedef struct {
+  dpiPool *pool;
+  ErlNifMutex *lock;
+  ErlNifCond *cond;
+  unsigned pending;
+} pool_warmup_job;
+
+typedef struct {
+  pool_warmup_job *job;
+  ErlNifTid thread;
+  ErlNifEnv *env;
+  ERL_NIF_TERM error;
+  int started;
+  int failed;
+} pool_warmup_worker;
+
+static ErlNifResourceType *pool_type;
+static ERL_NIF_TERM atom_ok;
+
+
+static void pool_dtor(ErlNifEnv *env, void *obj)
+{
+  pool_resource *res = obj;
+
+  if (res->pool)
+    dpiPool_release(res->pool);
+}
+
+
+int pool_load(ErlNifEnv *env)
+{
+  pool_type = enif_open_resource_type(env, NULL, "oracle_nif_pool",
+      pool_dtor, ERL_NIF_RT_CREATE, NULL);
+  if (!pool_type)
+    return -1;
+  atom_ok = enif_make_atom(env, "ok");
+  return 0;
+}
+
+
+int pool_get_resource(ErlNifEnv *env, ERL_NIF_TERM term, pool_resource **res)
+{
+  return enif_get_resource(env, term, pool_type, (void**) res);
+}
+
+
+// pool_create(usuário, senha, string de conexão, máximo de sessões) ->
+// {:ok, pool} | {:error, msg}
+ERL_NIF_TERM pool_create(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  ErlNifBinary user, password, connectString;
+  dpiCommonCreateParams commonParams;
+  dpiPoolCreateParams createParams;
+  unsigned maxSessions;
+  pool_resource *res;
+  ERL_NIF_TERM term;
+  dpiPool *pool;
+
+  if (!enif_inspect_binary(env, argv[0], &user) ||
+      !enif_inspect_binary(env, argv[1], &password) ||
+      !enif_inspect_binary(env, argv[2], &connectString) ||
+      !enif_get_uint(env, argv[3], &maxSessions) || maxSessions == 0)
+    return enif_make_badarg(env);
+  if (conn_create_context(env, &term) < 0)
+    return term;
+
+  conn_init_common_params(&commonParams);
+  dpiContext_initPoolCreateParams(conn_context(), &createParams);
+  createParams.maxSessions = maxSessions;
+  createParams.sessionIncrement = 1;
+  if (dpiPool_create(conn_context(), (const char*) user.data, user.size,
+      (const char*) password.data, password.size,
+      (const char*) connectString.data, connectString.size, &commonParams,
+      &createParams, &pool) < 0)
+    return conn_make_error(env);
+
+  res = enif_alloc_resource(pool_type, sizeof(pool_resource));
+  if (!res) {
+    dpiPool_release(pool);
+    return enif_make_badarg(env);
+  }
+  res->pool = pool;
+  res->maxSessions = maxSessions;
+  term = enif_make_resource(env, res);
+  enif_release_resource(res);
+  return enif_make_tuple2(env, atom_ok, term);
+}
+
+
+static void *pool_warmup_run(void *arg)
+{
+  pool_warmup_worker *worker = arg;
+  pool_warmup_job *job = worker->job;
+  dpiConn *conn = NULL;
+
+  if (dpiPool_acquireConnection(job->pool, NULL, 0, NULL, 0, NULL,
+      &conn) < 0 || dpiConn_ping(conn) < 0) {
+    worker->error = conn_make_error(worker->env);
+    worker->failed = 1;
+  }
+
+  enif_mutex_lock(job->lock);
+  if (--job->pending == 0)
+    enif_cond_broadcast(job->cond);
+  while (job->pending > 0)
+    enif_cond_wait(job->cond, job->lock);
+  enif_mutex_unlock(job->lock);
+
+  if (conn)
+    dpiConn_release(conn);
+  return NULL;
+}
+
+
+static void pool_metrics_put(ErlNifEnv *env, ERL_NIF_TERM *map,
+    const char *key, uint64_t value)
+{
+  enif_make_map_put(env, *map, enif_make_atom(env, key),
+      enif_make_uint64(env, value), map);
+}
+
+
+// pool_metrics(pool) -> {:ok, mapa} | {:error, msg}
+// Contadores acumulados desde a criação do pool (tempos em microssegundos)
+// e os números atuais de sessões abertas e em uso. O histograma de espera é
+// uma lista em que a posição n conta as esperas abaixo de 2^n µs.
+ERL_NIF_TERM pool_metrics(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  ERL_NIF_TERM map, buckets[DPI_POOL_WAIT_BUCKETS];
+  uint32_t busyCount, openCount;
+  dpiPoolMetrics metrics;
+  pool_resource *res;
+  unsigned i;
+
+  if (!pool_get_resource(env, argv[0], &res))
+    return enif_make_badarg(env);
+  if (dpiPool_getMetrics(res->pool, &metrics) < 0 ||
+      dpiPool_getBusyCount(res->pool, &busyCount) < 0 ||
+      dpiPool_getOpenCount(res->pool, &openCount) < 0)
+    return conn_make_error(env);
+
+  map = enif_make_new_map(env);
+  pool_metrics_put(env, &map, "busy", busyCount);
+  pool_metrics_put(env, &map, "open", openCount);
+  pool_metrics_put(env, &map, "acquires", metrics.numAcquires);
+  pool_metrics_put(env, &map, "acquire_failures", metrics.numAcquireFailures);
+  pool_metrics_put(env, &map, "acquire_timeouts", metrics.numAcquireTimeouts);
+  pool_metrics_put(env, &map, "acquire_wait_total", metrics.acquireWaitTotal);
+  pool_metrics_put(env, &map, "acquire_wait_max", metrics.acquireWaitMax);
+  pool_metrics_put(env, &map, "sessions_created", metrics.numSessionsCreated);
+  pool_metrics_put(env, &map, "session_create_total",
+      metrics.sessionCreateTotal);
+  pool_metrics_put(env, &map, "session_create_max", metrics.sessionCreateMax);
+  pool_metrics_put(env, &map, "tag_requests", metrics.numTagRequests);
+  pool_metrics_put(env, &map, "tag_matches", metrics.numTagMatches);
+  for (i = 0; i < DPI_POOL_WAIT_BUCKETS; i++)
+    buckets[i] = enif_make_uint64(env, metrics.acquireWaitBuckets[i]);
+  enif_make_map_put(env, map, enif_make_atom(env, "acquire_wait_histogram"),
+      enif_make_list_from_array(env, buckets, DPI_POOL_WAIT_BUCKETS), &map);
+  return enif_make_tuple2(env, atom_ok, map);
+}
+
+
+// pool_warmup(pool, sessões) -> {:ok, sessões abertas} | {:error, msg}
+// Abre e testa (ping) as sessões ao mesmo tempo, uma por thread, antes do
+// primeiro uso do pool; limitado ao máximo de sessões do pool.
+ERL_NIF_TERM pool_warmup(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  unsigned i, numSessions, numWarmed;
+  pool_warmup_worker *workers;
+  pool_warmup_job job;
+  pool_resource *res;
+  ERL_NIF_TERM result;
+  int firstFailed;
+
+  if (!pool_get_resource(env, argv[0], &res) ||
+      !enif_get_uint(env, argv[1], &numSessions))
+    return enif_make_badarg(env);
+  if (numSessions > res->maxSessions)
+    numSessions = res->maxSessions;
+  if (numSessions == 0)
+    return enif_make_tuple2(env, atom_ok, enif_make_uint(env, 0));
+
+  memset(&job, 0, sizeof(job));
+  job.pool = res->pool;
+  job.lock = enif_mutex_create("oracle_nif_warmup_lock");
+  job.cond = enif_cond_create("oracle_nif_warmup_cond");
+  workers = enif_alloc(numSessions * sizeof(pool_warmup_worker));
+  if (!job.lock || !job.cond || !workers) {
+    if (job.cond)
+      enif_cond_destroy(job.cond);
+    if (job.lock)
+      enif_mutex_destroy(job.lock);
+    if (workers)
+      enif_free(workers);
+    return enif_make_badarg(env);
+  }
+  memset(workers, 0, numSessions * sizeof(pool_warmup_worker));
+
+  // a barreira só conta as threads que de fato foram criadas
+  enif_mutex_lock(job.lock);
+  for (i = 0; i < numSessions; i++) {
+    workers[i].job = &job;
+    workers[i].env = enif_alloc_env();
+    job.pending++;
+    if (workers[i].env && enif_thread_create("oracle_nif_warmup",
+        &workers[i].thread, pool_warmup_run, &workers[i], NULL) == 0)
+      workers[i].started = 1;
+    else
+      job.pending--;
+  }
+  if (job.pending == 0)
+    enif_cond_broadcast(job.cond);
+  enif_mutex_unlock(job.lock);
+  for (i = 0; i < numSessions; i++) {
+    if (workers[i].started)
+      enif_thread_join(workers[i].thread, NULL);
+  }
+
+  // o resultado é o erro da primeira sessão que falhou, se houver
+  numWarmed = 0;
+  firstFailed = -1;
+  for (i = 0; i < numSessions; i++) {
+    if (workers[i].started && !workers[i].failed)
+      numWarmed++;
+    else if (workers[i].failed && firstFailed < 0)
+      firstFailed = i;
+  }
+  if (firstFailed >= 0)
+    result = enif_make_copy(env, workers[firstFailed].error);
+  else
+    result = enif_make_tuple2(env, atom_ok, enif_make_uint(env, numWarmed));
+
+  for (i = 0; i < numSessions; i++) {
+    if (workers[i].env)
+      enif_free_env(workers[i].env);
+  }
+  enif_free(workers);
+  enif_cond_destroy(job.cond);
+  enif_mutex_destroy(job.lock);
+  return result;
+}
@@ -0,0 +1,20 @@
+#ifndef DPIPOOL_NIF_H
+#define DPIPOOL_NIF_H
+
+#include <erl_nif.h>
+#include "dpi.h"
+
+// Pool de sessões guardado num recurso Erlang.
+typedef struct {
+  dpiPool *pool;
+  uint32_t maxSessions;
+} pool_resource;
+
+int pool_load(ErlNifEnv *env);
+int pool_get_resource(ErlNifEnv *env, ERL_NIF_TERM term, pool_resource **res);
+
+ERL_NIF_TERM pool_create(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM pool_metrics(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM pool_warmup(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]);
+
+#endif
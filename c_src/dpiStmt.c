@@ -17,6 +17,12 @@
 #include "dpiImpl.h"
 
 // forward declarations of internal functions only used in this file
+static int dpiStmt__allocateQueryVar(dpiStmt *stmt, dpiQueryInfo *info,
+        dpiVar **var, dpiData **data, dpiError *error);
+static dpiBindVar *dpiStmt__findBindVar(dpiStmt *stmt, uint32_t pos,
+        const char *name, uint32_t nameLength);
+static int dpiStmt__getImplicitResult(dpiStmt *stmt, dpiStmt **implicitResult,
+        dpiError *error);
 static int dpiStmt__getQueryInfo(dpiStmt *stmt, uint32_t pos,
         dpiQueryInfo *info, dpiError *error);
 static int dpiStmt__getQueryInfoFromParam(dpiStmt *stmt, void *param,
@@ -27,6 +33,77 @@ static int dpiStmt__reExecute(dpiStmt *stmt, uint32_t numIters,
         dpiExecMode mode, dpiError *error);
 
 
+//-----------------------------------------------------------------------------
+// dpiStmt__adjustFetchArraySize() [INTERNAL]
+//   Adjust the fetch array size so that the buffers used for fetching remain
+// within the size requested by dpiStmt_setAdaptiveFetch(). The size of each
+// row is estimated from the defined variables or, if a variable has not been
+// created yet, from the query metadata. The array size is doubled each time a
+// full batch of rows is fetched and halved when the time taken per row rises
+// well above the lowest time per row seen during the execution, which means
+// that larger fetches no longer pay off. The time is compared per row rather
+// than against a fixed limit, which a slow network could exceed even for a
+// single row. Variables that are referenced by the caller are never replaced
+// so the array size is also limited to the size of those variables.
+//-----------------------------------------------------------------------------
+void dpiStmt__adjustFetchArraySize(dpiStmt *stmt)
+{
+    uint32_t i, arraySize, maxArraySize, sizeInBytes;
+    uint64_t rowSize, rowFetchTime;
+    dpiVar *var;
+
+    // estimate the size of each row and the limit imposed by variables that
+    // cannot be replaced
+    rowSize = 0;
+    maxArraySize = DPI_ADAPTIVE_FETCH_MAX_ARRAY_SIZE;
+    for (i = 0; i < stmt->numQueryVars; i++) {
+        var = stmt->queryVars[i];
+        if (!var)
+            sizeInBytes = stmt->queryInfo[i].clientSizeInBytes;
+        else if (var->isDynamic)
+            sizeInBytes = (var->dynamicChunkSize > 0) ?
+                    var->dynamicChunkSize : DPI_DYNAMIC_BYTES_CHUNK_SIZE;
+        else sizeInBytes = var->sizeInBytes;
+        rowSize += sizeInBytes + sizeof(dpiData) + sizeof(int16_t) +
+                sizeof(uint32_t) + sizeof(uint16_t);
+        if (var && var->refCount > 1 && var->maxArraySize < maxArraySize)
+            maxArraySize = var->maxArraySize;
+    }
+    if (rowSize > 0 && stmt->adaptiveFetchBufferSize / rowSize < maxArraySize)
+        maxArraySize = (uint32_t) (stmt->adaptiveFetchBufferSize / rowSize);
+    if (stmt->adaptiveFetchMaxArraySize > 0 &&
+            stmt->adaptiveFetchMaxArraySize < maxArraySize)
+        maxArraySize = stmt->adaptiveFetchMaxArraySize;
+    if (maxArraySize == 0)
+        maxArraySize = 1;
+
+    // grow or shrink based on the time taken per row (in nanoseconds) by the
+    // previous fetch; a size found to be too slow is not tried again during
+    // the execution, so the array size does not keep going back and forth
+    arraySize = stmt->fetchArraySize;
+    if (stmt->lastFetchRows > 0) {
+        rowFetchTime = stmt->lastFetchTime * 1000 / stmt->lastFetchRows;
+        if (stmt->minRowFetchTime == 0 ||
+                rowFetchTime < stmt->minRowFetchTime)
+            stmt->minRowFetchTime = rowFetchTime;
+        if (rowFetchTime > stmt->minRowFetchTime *
+                DPI_ADAPTIVE_FETCH_MAX_SLOWDOWN) {
+            if (arraySize > 1) {
+                arraySize /= 2;
+                stmt->adaptiveFetchMaxArraySize = arraySize;
+            }
+        } else if (stmt->lastFetchRows == stmt->fetchArraySize) {
+            arraySize = (arraySize > maxArraySize / 2) ? maxArraySize :
+                    arraySize * 2;
+        }
+        stmt->lastFetchRows = 0;
+    }
+    if (arraySize > maxArraySize)
+        arraySize = maxArraySize;
+    stmt->fetchArraySize = arraySize;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiStmt__allocate() [INTERNAL]
 //   Create a new statement object and return it. In case of error NULL is
@@ -48,11 +125,57 @@ int dpiStmt__allocate(dpiConn *conn, int scrollable, dpiStmt **stmt,
     tempStmt->conn = conn;
     tempStmt->fetchArraySize = DPI_DEFAULT_FETCH_ARRAY_SIZE;
     tempStmt->scrollable = scrollable;
+    tempStmt->prefetchRows = conn->prefetchRows;
+    tempStmt->prefetchMemory = conn->prefetchMemory;
+    tempStmt->hasPrefetchRows = conn->hasPrefetchRows;
+    tempStmt->hasPrefetchMemory = conn->hasPrefetchMemory;
+    tempStmt->inlineLobSize = conn->inlineLobSize;
     *stmt = tempStmt;
     return DPI_SUCCESS;
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiStmt__allocateQueryVar() [INTERNAL]
+//   Allocate the variable used to fetch a query column. When LOBs are fetched
+// inline, CLOB and BLOB columns are defined as VARCHAR and RAW instead of
+// LOB locators: OCI then returns the values with the rows, instead of a
+// locator per row which would require a separate round trip to read. The
+// define is always dynamic (piecewise) so that values of any length can be
+// fetched; the first piece of each row has the inline LOB size, so values up
+// to that size arrive in a single piece. The query information reported to
+// the caller is left untouched.
+//-----------------------------------------------------------------------------
+static int dpiStmt__allocateQueryVar(dpiStmt *stmt, dpiQueryInfo *info,
+        dpiVar **var, dpiData **data, dpiError *error)
+{
+    dpiOracleTypeNum oracleTypeNum;
+
+    switch (info->oracleTypeNum) {
+        case DPI_ORACLE_TYPE_CLOB:
+            oracleTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+            break;
+        case DPI_ORACLE_TYPE_BLOB:
+            oracleTypeNum = DPI_ORACLE_TYPE_RAW;
+            break;
+        default:
+            oracleTypeNum = DPI_ORACLE_TYPE_NONE;
+            break;
+    }
+    if (stmt->inlineLobSize == 0 || oracleTypeNum == DPI_ORACLE_TYPE_NONE)
+        return dpiVar__allocate(stmt->conn, info->oracleTypeNum,
+                info->defaultNativeTypeNum, stmt->fetchArraySize,
+                info->clientSizeInBytes, 1, 0, info->objectType, var, data,
+                error);
+    if (dpiVar__allocate(stmt->conn, oracleTypeNum, DPI_NATIVE_TYPE_BYTES,
+            stmt->fetchArraySize, DPI_MAX_BASIC_BUFFER_SIZE + 1, 1, 0, NULL,
+            var, data, error) < 0)
+        return DPI_FAILURE;
+    (*var)->dynamicChunkSize = stmt->inlineLobSize;
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiStmt__bind() [INTERNAL]
 //   Bind the variable to the statement using either a position or a name. A
@@ -63,7 +186,7 @@ static int dpiStmt__bind(dpiStmt *stmt, dpiVar *var, int addReference,
 {
     dpiBindVar *bindVars, *entry;
     void *bindHandle = NULL;
-    int found, dynamicBind;
+    int dynamicBind;
     uint32_t i;
 
     // a zero length name is not supported
@@ -72,19 +195,10 @@ static int dpiStmt__bind(dpiStmt *stmt, dpiVar *var, int addReference,
                 DPI_ERR_NOT_SUPPORTED);
 
     // check to see if the bind position or name has already been bound
-    found = 0;
-    for (i = 0; i < stmt->numBindVars; i++) {
-        entry = &stmt->bindVars[i];
-        if (entry->pos == pos && entry->nameLength == nameLength) {
-            if (nameLength > 0 && strncmp(entry->name, name, nameLength) != 0)
-                continue;
-            found = 1;
-            break;
-        }
-    }
+    entry = dpiStmt__findBindVar(stmt, pos, name, nameLength);
 
     // if already found, use that entry
-    if (found) {
+    if (entry) {
 
         // if already bound, no need to bind a second time
         if (entry->var == var)
@@ -144,6 +258,10 @@ static int dpiStmt__bind(dpiStmt *stmt, dpiVar *var, int addReference,
         dpiGen__setRefCount(var, error, 1);
     entry->var = var;
     dynamicBind = stmt->isReturning || var->isDynamic;
+    if (dynamicBind && dpiVar__convertToLength32(var, error) < 0)
+        return DPI_FAILURE;
+    if (!dynamicBind)
+        dpiVar__restoreLength16(var);
     if (pos > 0) {
         if (stmt->env->versionInfo->versionNum < 12) {
             if (dpiOci__bindByPos(stmt, &bindHandle, pos, dynamicBind, var,
@@ -285,6 +403,25 @@ static void dpiStmt__clearQueryVars(dpiStmt *stmt, dpiError *error)
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiStmt__clearScrollWindows() [INTERNAL]
+//   Discard the blocks of rows retained by a scrollable statement. This is
+// done whenever the query variables change as the retained buffers would no
+// longer match them.
+//-----------------------------------------------------------------------------
+static void dpiStmt__clearScrollWindows(dpiStmt *stmt)
+{
+    uint32_t i;
+
+    if (stmt->scrollWindows) {
+        for (i = 0; i < DPI_SCROLL_CACHE_MAX_WINDOWS; i++) {
+            stmt->scrollWindows[i].numRows = 0;
+            stmt->scrollWindows[i].lastUsed = 0;
+        }
+    }
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiStmt__close() [INTERNAL]
 //   Internal method used for closing the statement. If the statement is marked
@@ -295,9 +432,19 @@ static void dpiStmt__clearQueryVars(dpiStmt *stmt, dpiError *error)
 static int dpiStmt__close(dpiStmt *stmt, const char *tag,
         uint32_t tagLength, int propagateErrors, dpiError *error)
 {
+    uint32_t i;
+
     dpiStmt__clearBatchErrors(stmt, error);
     dpiStmt__clearBindVars(stmt, error);
     dpiStmt__clearQueryVars(stmt, error);
+    if (stmt->scrollWindows) {
+        for (i = 0; i < DPI_SCROLL_CACHE_MAX_WINDOWS; i++) {
+            if (stmt->scrollWindows[i].buffer)
+                free(stmt->scrollWindows[i].buffer);
+        }
+        free(stmt->scrollWindows);
+        stmt->scrollWindows = NULL;
+    }
     if (stmt->handle) {
         if (stmt->isOwned)
             dpiOci__handleFree(stmt->handle, DPI_OCI_HTYPE_STMT);
@@ -316,6 +463,49 @@ static int dpiStmt__close(dpiStmt *stmt, const char *tag,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiStmt__copyScrollWindow() [INTERNAL]
+//   Copy the buffers of the query variables to the window (when saving) or
+// from the window back to the query variables (when restoring). The buffers
+// of each variable are laid out one after the other in the window.
+//-----------------------------------------------------------------------------
+static void dpiStmt__copyScrollWindow(dpiStmt *stmt, dpiScrollWindow *window,
+        int save)
+{
+    size_t sizes[4];
+    void *buffers[4];
+    uint32_t i, j;
+    char *ptr;
+    dpiVar *var;
+
+    ptr = window->buffer;
+    for (i = 0; i < stmt->numQueryVars; i++) {
+        var = stmt->queryVars[i];
+        buffers[0] = var->data.asRaw;
+        sizes[0] = (size_t) window->numRows * var->sizeInBytes;
+        buffers[1] = var->indicator;
+        sizes[1] = window->numRows * sizeof(int16_t);
+        buffers[2] = var->actualLength32;
+        sizes[2] = window->numRows * sizeof(uint32_t);
+        if (!var->actualLength32) {
+            buffers[2] = var->actualLength16;
+            sizes[2] = (var->actualLength16) ?
+                    window->numRows * sizeof(uint16_t) : 0;
+        }
+        buffers[3] = var->returnCode;
+        sizes[3] = (var->returnCode) ? window->numRows * sizeof(uint16_t) : 0;
+        for (j = 0; j < 4; j++) {
+            if (sizes[j] == 0)
+                continue;
+            if (save)
+                memcpy(ptr, buffers[j], sizes[j]);
+            else memcpy(buffers[j], ptr, sizes[j]);
+            ptr += sizes[j];
+        }
+    }
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiStmt__createBindVar() [INTERNAL]
 //   Create a bind variable given a value to bind.
@@ -326,6 +516,7 @@ static int dpiStmt__createBindVar(dpiStmt *stmt,
 {
     dpiOracleTypeNum oracleTypeNum;
     dpiObjectType *objType;
+    dpiBindVar *entry;
     dpiData *varData;
     dpiVar *tempVar;
     uint32_t size;
@@ -369,14 +560,35 @@ static int dpiStmt__createBindVar(dpiStmt *stmt,
                     DPI_ERR_UNHANDLED_CONVERSION, 0, nativeTypeNum);
     }
 
+    // if a variable created by a previous call is still bound in this
+    // position and is able to hold the new value, simply replace its value;
+    // a variable referenced elsewhere is never modified
+    entry = dpiStmt__findBindVar(stmt, pos, name, nameLength);
+    if (entry && entry->var) {
+        tempVar = entry->var;
+        if (tempVar->refCount == 1 && !tempVar->isDynamic &&
+                !tempVar->isArray && tempVar->maxArraySize == 1 &&
+                tempVar->nativeTypeNum == nativeTypeNum &&
+                tempVar->type->oracleTypeNum == oracleTypeNum &&
+                tempVar->objectType == objType &&
+                size <= tempVar->sizeInBytes) {
+            if (dpiVar__copyData(tempVar, 0, data, error) < 0)
+                return DPI_FAILURE;
+            *var = tempVar;
+            return DPI_SUCCESS;
+        }
+    }
+
     // create the variable and set its value
     if (dpiVar__allocate(stmt->conn, oracleTypeNum, nativeTypeNum, 1, size, 1,
             0, objType, &tempVar, &varData, error) < 0)
         return DPI_FAILURE;
 
     // copy value from source to target data
-    if (dpiVar__copyData(tempVar, 0, data, error) < 0)
+    if (dpiVar__copyData(tempVar, 0, data, error) < 0) {
+        dpiVar__free(tempVar, error);
         return DPI_FAILURE;
+    }
 
     // bind variable to statement
     if (dpiStmt__bind(stmt, tempVar, 0, pos, name, nameLength, error) < 0) {
@@ -431,6 +643,11 @@ static int dpiStmt__createQueryVars(dpiStmt *stmt, dpiError *error)
     }
 
     // indicate start of fetch
+    dpiStmt__clearScrollWindows(stmt);
+    stmt->scrollWindowRestored = 0;
+    stmt->lastFetchRows = 0;
+    stmt->minRowFetchTime = 0;
+    stmt->adaptiveFetchMaxArraySize = 0;
     stmt->bufferRowIndex = stmt->fetchArraySize;
     stmt->hasRowsToFetch = 1;
     return DPI_SUCCESS;
@@ -450,8 +667,11 @@ int dpiStmt__define(dpiStmt *stmt, uint32_t pos, dpiVar *var, dpiError *error)
     // no need to perform define if variable is unchanged
     if (stmt->queryVars[pos - 1] == var)
         return DPI_SUCCESS;
+    dpiStmt__clearScrollWindows(stmt);
 
     // perform the define
+    if (!var->isDynamic)
+        dpiVar__restoreLength16(var);
     if (stmt->env->versionInfo->versionNum < 12) {
         if (dpiOci__defineByPos(stmt, &defineHandle, pos, var, error) < 0)
             return DPI_FAILURE;
@@ -520,11 +740,19 @@ static int dpiStmt__execute(dpiStmt *stmt, uint32_t numIters,
     }
 
     // for queries, set the prefetch rows to the fetch array size in order to
-    // avoid the network round trip for the first fetch
+    // avoid the network round trip for the first fetch, unless the prefetch
+    // rows and/or memory have been set explicitly
     if (stmt->statementType == DPI_STMT_TYPE_SELECT) {
-        if (dpiOci__attrSet(stmt->handle, DPI_OCI_HTYPE_STMT,
-                &stmt->fetchArraySize, sizeof(stmt->fetchArraySize),
-                DPI_OCI_ATTR_PREFETCH_ROWS, "set prefetch rows", error) < 0)
+        prefetchSize = (stmt->hasPrefetchRows) ? stmt->prefetchRows :
+                stmt->fetchArraySize;
+        if (dpiOci__attrSet(stmt->handle, DPI_OCI_HTYPE_STMT, &prefetchSize,
+                sizeof(prefetchSize), DPI_OCI_ATTR_PREFETCH_ROWS,
+                "set prefetch rows", error) < 0)
+            return DPI_FAILURE;
+        if (stmt->hasPrefetchMemory && dpiOci__attrSet(stmt->handle,
+                DPI_OCI_HTYPE_STMT, &stmt->prefetchMemory,
+                sizeof(stmt->prefetchMemory), DPI_OCI_ATTR_PREFETCH_MEMORY,
+                "set prefetch memory", error) < 0)
             return DPI_FAILURE;
     }
 
@@ -568,10 +796,12 @@ static int dpiStmt__execute(dpiStmt *stmt, uint32_t numIters,
 
     // determine number of query columns (for queries)
     // reset prefetch rows to 0 as subsequent fetches can fetch directly into
-    // the defined fetch areas
+    // the defined fetch areas; prefetch rows set explicitly are retained
     if (stmt->statementType == DPI_STMT_TYPE_SELECT) {
         if (dpiStmt__createQueryVars(stmt, error) < 0)
             return DPI_FAILURE;
+        if (stmt->hasPrefetchRows)
+            return DPI_SUCCESS;
         prefetchSize = 0;
         if (dpiOci__attrSet(stmt->handle, DPI_OCI_HTYPE_STMT, &prefetchSize,
                 sizeof(prefetchSize), DPI_OCI_ATTR_PREFETCH_ROWS,
@@ -589,24 +819,39 @@ static int dpiStmt__execute(dpiStmt *stmt, uint32_t numIters,
 //-----------------------------------------------------------------------------
 static int dpiStmt__fetch(dpiStmt *stmt, dpiError *error)
 {
+    dpiFetchMode mode = DPI_MODE_FETCH_NEXT;
+    uint64_t startTime = 0;
+    int32_t offset = 0;
+
     // perform any pre-fetch activities required
     if (dpiStmt__preFetch(stmt, error) < 0)
         return DPI_FAILURE;
 
-    // perform fetch
-    if (dpiOci__stmtFetch2(stmt, stmt->fetchArraySize, DPI_MODE_FETCH_NEXT, 0,
+    // perform fetch; the time taken is retained when the fetch array size is
+    // being adjusted automatically; if a block of rows retained by a
+    // scrollable statement was restored, an absolute fetch is needed
+    dpiStmt__getFetchMode(stmt, stmt->rowCount + 1, &mode, &offset);
+    if (stmt->adaptiveFetchBufferSize)
+        startTime = dpiUtils__getMonotonicTime();
+    if (dpiOci__stmtFetch2(stmt, stmt->fetchArraySize, mode, offset,
             error) < 0)
         return DPI_FAILURE;
+    if (stmt->adaptiveFetchBufferSize)
+        stmt->lastFetchTime = dpiUtils__getMonotonicTime() - startTime;
 
     // determine the number of rows fetched into buffers
     if (dpiOci__attrGet(stmt->handle, DPI_OCI_HTYPE_STMT,
             &stmt->bufferRowCount, 0, DPI_OCI_ATTR_ROWS_FETCHED,
             "get rows fetched", error) < 0)
         return DPI_FAILURE;
+    if (stmt->adaptiveFetchBufferSize)
+        stmt->lastFetchRows = stmt->bufferRowCount;
 
     // set buffer row info
     stmt->bufferMinRow = stmt->rowCount + 1;
     stmt->bufferRowIndex = 0;
+    if (stmt->scrollable)
+        dpiStmt__saveScrollWindow(stmt);
 
     // perform post-fetch activities required
     if (dpiStmt__postFetch(stmt, error) < 0)
@@ -616,6 +861,29 @@ static int dpiStmt__fetch(dpiStmt *stmt, dpiError *error)
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiStmt__findBindVar() [INTERNAL]
+//   Return the entry for the given bind position or name, or NULL if that
+// position or name has not been bound yet.
+//-----------------------------------------------------------------------------
+static dpiBindVar *dpiStmt__findBindVar(dpiStmt *stmt, uint32_t pos,
+        const char *name, uint32_t nameLength)
+{
+    dpiBindVar *entry;
+    uint32_t i;
+
+    for (i = 0; i < stmt->numBindVars; i++) {
+        entry = &stmt->bindVars[i];
+        if (entry->pos == pos && entry->nameLength == nameLength) {
+            if (nameLength > 0 && strncmp(entry->name, name, nameLength) != 0)
+                continue;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiStmt__free() [INTERNAL]
 //   Free the memory associated with the statement.
@@ -715,6 +983,57 @@ static int dpiStmt__getBatchErrors(dpiStmt *stmt, dpiError *error)
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiStmt__getImplicitResult() [INTERNAL]
+//   Return the next implicit result from the previous execution as a new
+// statement with its query variables created, or NULL if no more exist.
+//-----------------------------------------------------------------------------
+static int dpiStmt__getImplicitResult(dpiStmt *stmt, dpiStmt **implicitResult,
+        dpiError *error)
+{
+    dpiStmt *tempStmt;
+    void *handle;
+
+    *implicitResult = NULL;
+    if (stmt->env->versionInfo->versionNum < 12)
+        return dpiError__set(error, "unsupported Oracle client",
+                DPI_ERR_NOT_SUPPORTED);
+    if (dpiOci__stmtGetNextResult(stmt, &handle, error) < 0)
+        return DPI_FAILURE;
+    if (handle) {
+        if (dpiStmt__allocate(stmt->conn, 0, &tempStmt, error) < 0)
+            return DPI_FAILURE;
+        tempStmt->handle = handle;
+        if (dpiStmt__createQueryVars(tempStmt, error) < 0) {
+            dpiStmt__free(tempStmt, error);
+            return DPI_FAILURE;
+        }
+        *implicitResult = tempStmt;
+    }
+    return DPI_SUCCESS;
+}
+
+
+//-----------------------------------------------------------------------------
+// dpiStmt__getFetchMode() [INTERNAL]
+//   Adjust the mode and offset of the next fetch. After a block of rows
+// retained by a scrollable statement was restored, the cursor is no longer
+// positioned at the end of the current block so relative fetches are replaced
+// by an absolute fetch of the desired row.
+//-----------------------------------------------------------------------------
+void dpiStmt__getFetchMode(dpiStmt *stmt, uint64_t desiredRow,
+        dpiFetchMode *mode, int32_t *offset)
+{
+    if (stmt->scrollWindowRestored && (*mode == DPI_MODE_FETCH_NEXT ||
+            *mode == DPI_MODE_FETCH_PRIOR ||
+            *mode == DPI_MODE_FETCH_RELATIVE)) {
+        *mode = DPI_MODE_FETCH_ABSOLUTE;
+        *offset = (int32_t) desiredRow;
+    }
+    stmt->scrollWindowRestored = 0;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiStmt__getQueryInfo() [INTERNAL]
 //   Get query information for the position in question.
@@ -833,6 +1152,54 @@ static int dpiStmt__getQueryInfoFromParam(dpiStmt *stmt, void *param,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiStmt__getScrollWindowSize() [INTERNAL]
+//   Return the size of the buffer needed to retain the given number of rows
+// of the query variables. Zero is returned if any of the variables uses
+// descriptors, handles or dynamically allocated buffers, which cannot simply
+// be copied.
+//-----------------------------------------------------------------------------
+static size_t dpiStmt__getScrollWindowSize(dpiStmt *stmt, uint32_t numRows)
+{
+    size_t size, rowSize;
+    uint32_t i;
+    dpiVar *var;
+
+    size = 0;
+    for (i = 0; i < stmt->numQueryVars; i++) {
+        var = stmt->queryVars[i];
+        if (!var || var->isDynamic)
+            return 0;
+        switch (var->type->oracleTypeNum) {
+            case DPI_ORACLE_TYPE_VARCHAR:
+            case DPI_ORACLE_TYPE_NVARCHAR:
+            case DPI_ORACLE_TYPE_CHAR:
+            case DPI_ORACLE_TYPE_NCHAR:
+            case DPI_ORACLE_TYPE_RAW:
+            case DPI_ORACLE_TYPE_NATIVE_FLOAT:
+            case DPI_ORACLE_TYPE_NATIVE_DOUBLE:
+            case DPI_ORACLE_TYPE_NATIVE_INT:
+            case DPI_ORACLE_TYPE_NATIVE_UINT:
+            case DPI_ORACLE_TYPE_NUMBER:
+            case DPI_ORACLE_TYPE_DATE:
+            case DPI_ORACLE_TYPE_BOOLEAN:
+                break;
+            default:
+                return 0;
+        }
+        rowSize = var->sizeInBytes + sizeof(int16_t);
+        if (var->actualLength32)
+            rowSize += sizeof(uint32_t);
+        else if (var->actualLength16)
+            rowSize += sizeof(uint16_t);
+        if (var->returnCode)
+            rowSize += sizeof(uint16_t);
+        size += rowSize * numRows;
+    }
+    return size;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiStmt__init() [INTERNAL]
 //   Initialize the statement for use. This is needed when preparing a
@@ -867,17 +1234,15 @@ int dpiStmt__init(dpiStmt *stmt, dpiError *error)
 //-----------------------------------------------------------------------------
 static int dpiStmt__postFetch(dpiStmt *stmt, dpiError *error)
 {
-    uint32_t i, j;
     dpiVar *var;
+    uint32_t i;
 
     for (i = 0; i < stmt->numQueryVars; i++) {
         var = stmt->queryVars[i];
-        for (j = 0; j < stmt->bufferRowCount; j++) {
-            if (dpiVar__getValue(var, j, &var->externalData[j], error) < 0)
-                return DPI_FAILURE;
-            if (var->type->requiresPreFetch)
-                var->requiresPreFetch = 1;
-        }
+        if (dpiVar__getValues(var, 0, stmt->bufferRowCount, error) < 0)
+            return DPI_FAILURE;
+        if (stmt->bufferRowCount > 0 && var->type->requiresPreFetch)
+            var->requiresPreFetch = 1;
         var->error = NULL;
     }
 
@@ -894,25 +1259,43 @@ static int dpiStmt__postFetch(dpiStmt *stmt, dpiError *error)
 //-----------------------------------------------------------------------------
 static int dpiStmt__preFetch(dpiStmt *stmt, dpiError *error)
 {
+    uint32_t i, size, chunkSize;
     dpiQueryInfo *queryInfo;
     dpiData *data;
     dpiVar *var;
-    uint32_t i;
 
     if (!stmt->queryInfo && dpiStmt__createQueryVars(stmt, error) < 0)
         return DPI_FAILURE;
+    if (stmt->adaptiveFetchBufferSize)
+        dpiStmt__adjustFetchArraySize(stmt);
     for (i = 0; i < stmt->numQueryVars; i++) {
         var = stmt->queryVars[i];
         if (!var) {
             queryInfo = &stmt->queryInfo[i];
-            if (dpiVar__allocate(stmt->conn, queryInfo->oracleTypeNum,
-                    queryInfo->defaultNativeTypeNum, stmt->fetchArraySize,
-                    queryInfo->clientSizeInBytes, 1, 0, queryInfo->objectType,
-                    &var, &data, error) < 0)
+            if (dpiStmt__allocateQueryVar(stmt, queryInfo, &var, &data,
+                    error) < 0)
                 return DPI_FAILURE;
             if (dpiStmt__define(stmt, i + 1, var, error) < 0)
                 return DPI_FAILURE;
             dpiGen__setRefCount(var, error, -1);
+
+        // when adjusting the fetch array size automatically, replace any
+        // variable (only referenced by the statement) that is too small
+        } else if (stmt->adaptiveFetchBufferSize && var->refCount == 1 &&
+                stmt->fetchArraySize > var->maxArraySize) {
+            size = (var->isDynamic) ? DPI_MAX_BASIC_BUFFER_SIZE + 1 :
+                    var->sizeInBytes;
+            chunkSize = var->dynamicChunkSize;
+            if (dpiVar__allocate(stmt->conn, var->type->oracleTypeNum,
+                    var->nativeTypeNum, stmt->fetchArraySize, size, 1, 0,
+                    var->objectType, &var, &data, error) < 0)
+                return DPI_FAILURE;
+            var->dynamicChunkSize = chunkSize;
+            if (dpiStmt__define(stmt, i + 1, var, error) < 0) {
+                dpiGen__setRefCount(var, error, -1);
+                return DPI_FAILURE;
+            }
+            dpiGen__setRefCount(var, error, -1);
         }
         var->error = error;
         if (stmt->fetchArraySize > var->maxArraySize)
@@ -1002,6 +1385,148 @@ static int dpiStmt__reExecute(dpiStmt *stmt, uint32_t numIters,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiStmt__reset() [INTERNAL]
+//   Reset a statement that owns its handle so that it can accept a new cursor,
+// as is done for REF cursor columns. The handle is freed, which closes the
+// cursor on the server, and replaced by a new one; the statement itself and
+// the count of open children of the connection are kept. Everything else is
+// returned to the state it had when the statement was allocated.
+//-----------------------------------------------------------------------------
+int dpiStmt__reset(dpiStmt *stmt, dpiError *error)
+{
+    dpiStmt__clearBatchErrors(stmt, error);
+    dpiStmt__clearBindVars(stmt, error);
+    dpiStmt__clearQueryVars(stmt, error);
+    dpiStmt__clearScrollWindows(stmt);
+    dpiOci__handleFree(stmt->handle, DPI_OCI_HTYPE_STMT);
+    stmt->handle = NULL;
+    if (dpiOci__handleAlloc(stmt->env, &stmt->handle, DPI_OCI_HTYPE_STMT,
+            "allocate statement", error) < 0) {
+        stmt->handle = NULL;
+        dpiConn__decrementOpenChildCount(stmt->conn, error);
+        return DPI_FAILURE;
+    }
+    stmt->fetchArraySize = DPI_DEFAULT_FETCH_ARRAY_SIZE;
+    stmt->bufferRowCount = 0;
+    stmt->bufferRowIndex = 0;
+    stmt->bufferMinRow = 0;
+    stmt->rowCount = 0;
+    stmt->statementType = 0;
+    stmt->hasRowsToFetch = 0;
+    stmt->isReturning = 0;
+    stmt->deleteFromCache = 0;
+    stmt->adaptiveFetchBufferSize = 0;
+    stmt->adaptiveFetchMaxArraySize = 0;
+    stmt->lastFetchTime = 0;
+    stmt->lastFetchRows = 0;
+    stmt->minRowFetchTime = 0;
+    stmt->prefetchRows = stmt->conn->prefetchRows;
+    stmt->prefetchMemory = stmt->conn->prefetchMemory;
+    stmt->hasPrefetchRows = stmt->conn->hasPrefetchRows;
+    stmt->hasPrefetchMemory = stmt->conn->hasPrefetchMemory;
+    stmt->inlineLobSize = stmt->conn->inlineLobSize;
+    stmt->scrollWindowUseCount = 0;
+    stmt->scrollWindowRestored = 0;
+    return DPI_SUCCESS;
+}
+
+
+//-----------------------------------------------------------------------------
+// dpiStmt__restoreScrollWindow() [INTERNAL]
+//   Look for a retained block of rows containing the desired row and, if one
+// is found, restore it into the query variables as if it had just been
+// fetched.
+//-----------------------------------------------------------------------------
+int dpiStmt__restoreScrollWindow(dpiStmt *stmt, uint64_t desiredRow,
+        int *found, dpiError *error)
+{
+    dpiScrollWindow *window;
+    uint32_t i;
+
+    *found = 0;
+    if (!stmt->scrollWindows)
+        return DPI_SUCCESS;
+    for (i = 0; i < DPI_SCROLL_CACHE_MAX_WINDOWS; i++) {
+        window = &stmt->scrollWindows[i];
+        if (window->numRows > 0 && desiredRow >= window->minRow &&
+                desiredRow < window->minRow + window->numRows)
+            break;
+    }
+    if (i == DPI_SCROLL_CACHE_MAX_WINDOWS)
+        return DPI_SUCCESS;
+
+    dpiStmt__copyScrollWindow(stmt, window, 0);
+    window->lastUsed = ++stmt->scrollWindowUseCount;
+    stmt->bufferRowCount = window->numRows;
+    stmt->bufferMinRow = window->minRow;
+    stmt->scrollWindowRestored = 1;
+    if (dpiStmt__postFetch(stmt, error) < 0)
+        return DPI_FAILURE;
+    stmt->bufferRowIndex = (uint32_t) (desiredRow - stmt->bufferMinRow);
+    stmt->rowCount = desiredRow - 1;
+    *found = 1;
+    return DPI_SUCCESS;
+}
+
+
+//-----------------------------------------------------------------------------
+// dpiStmt__saveScrollWindow() [INTERNAL]
+//   Retain a copy of the block of rows just fetched by a scrollable statement,
+// replacing the least recently used block if all of them are in use. As the
+// cache is only an optimization, nothing is retained if memory cannot be
+// allocated.
+//-----------------------------------------------------------------------------
+void dpiStmt__saveScrollWindow(dpiStmt *stmt)
+{
+    dpiScrollWindow *window, *candidate;
+    size_t size;
+    uint32_t i;
+
+    size = dpiStmt__getScrollWindowSize(stmt, stmt->bufferRowCount);
+    if (size == 0)
+        return;
+    if (!stmt->scrollWindows) {
+        stmt->scrollWindows = calloc(DPI_SCROLL_CACHE_MAX_WINDOWS,
+                sizeof(dpiScrollWindow));
+        if (!stmt->scrollWindows)
+            return;
+    }
+
+    // replace the block starting at the same row, if one exists; otherwise,
+    // use the least recently used block; unused blocks have a last use of
+    // zero and are therefore chosen first
+    window = &stmt->scrollWindows[0];
+    for (i = 0; i < DPI_SCROLL_CACHE_MAX_WINDOWS; i++) {
+        candidate = &stmt->scrollWindows[i];
+        if (candidate->numRows > 0 &&
+                candidate->minRow == stmt->bufferMinRow) {
+            window = candidate;
+            break;
+        }
+        if (candidate->lastUsed < window->lastUsed)
+            window = candidate;
+    }
+
+    // ensure the buffer is large enough and copy the rows to it
+    window->numRows = 0;
+    window->lastUsed = 0;
+    if (size > window->bufferSize) {
+        if (window->buffer)
+            free(window->buffer);
+        window->bufferSize = 0;
+        window->buffer = malloc(size);
+        if (!window->buffer)
+            return;
+        window->bufferSize = size;
+    }
+    window->minRow = stmt->bufferMinRow;
+    window->numRows = stmt->bufferRowCount;
+    window->lastUsed = ++stmt->scrollWindowUseCount;
+    dpiStmt__copyScrollWindow(stmt, window, 1);
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiStmt_addRef() [PUBLIC]
 //   Add a reference to the statement.
@@ -1430,30 +1955,61 @@ int dpiStmt_getFetchArraySize(dpiStmt *stmt, uint32_t *arraySize)
 //-----------------------------------------------------------------------------
 int dpiStmt_getImplicitResult(dpiStmt *stmt, dpiStmt **implicitResult)
 {
-    dpiStmt *tempStmt;
     dpiError error;
-    void *handle;
 
     if (dpiStmt__checkOpen(stmt, __func__, &error) < 0)
         return DPI_FAILURE;
     DPI_CHECK_PTR_NOT_NULL(implicitResult)
-    if (stmt->env->versionInfo->versionNum < 12)
-        return dpiError__set(&error, "unsupported Oracle client",
-                DPI_ERR_NOT_SUPPORTED);
-    if (dpiOci__stmtGetNextResult(stmt, &handle, &error) < 0)
+    return dpiStmt__getImplicitResult(stmt, implicitResult, &error);
+}
+
+
+//-----------------------------------------------------------------------------
+// dpiStmt_getImplicitResults() [PUBLIC]
+//   Return all of the implicit results from the previous execution, up to the
+// number given in numResults, in a single call. The first fetch of each
+// result is performed before returning, using the fetch array size of the
+// parent statement, so that the rows of all of the results are already
+// buffered when the caller starts consuming them. On return numResults
+// contains the number of results returned.
+//-----------------------------------------------------------------------------
+int dpiStmt_getImplicitResults(dpiStmt *stmt, uint32_t *numResults,
+        dpiStmt **implicitResults)
+{
+    dpiStmt *tempStmt;
+    dpiError error;
+    uint32_t i;
+    int status;
+
+    if (dpiStmt__checkOpen(stmt, __func__, &error) < 0)
         return DPI_FAILURE;
-    *implicitResult = NULL;
-    if (handle) {
-        if (dpiStmt__allocate(stmt->conn, 0, &tempStmt, &error) < 0)
-            return DPI_FAILURE;
-        tempStmt->handle = handle;
-        if (dpiStmt__createQueryVars(tempStmt, &error) < 0) {
-            dpiStmt__free(tempStmt, &error);
-            return DPI_FAILURE;
+    DPI_CHECK_PTR_NOT_NULL(numResults)
+    DPI_CHECK_PTR_NOT_NULL(implicitResults)
+    status = DPI_SUCCESS;
+    for (i = 0; i < *numResults; i++) {
+        status = dpiStmt__getImplicitResult(stmt, &tempStmt, &error);
+        if (status < 0 || !tempStmt)
+            break;
+        implicitResults[i] = tempStmt;
+        tempStmt->fetchArraySize = stmt->fetchArraySize;
+        status = dpiStmt__fetch(tempStmt, &error);
+        if (status < 0) {
+            i++;
+            break;
         }
-        *implicitResult = tempStmt;
     }
-    return DPI_SUCCESS;
+    if (status == DPI_SUCCESS) {
+        *numResults = i;
+        return DPI_SUCCESS;
+    }
+
+    // on failure, release the results that were already acquired
+    while (i > 0) {
+        dpiStmt__free(implicitResults[--i], &error);
+        implicitResults[i] = NULL;
+    }
+    *numResults = 0;
+    return DPI_FAILURE;
 }
 
 
@@ -1529,6 +2085,38 @@ int dpiStmt_getQueryInfo(dpiStmt *stmt, uint32_t pos, dpiQueryInfo *info)
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiStmt_getQueryNullBitmap() [PUBLIC]
+//   Return the bitmap of NULL values for the specified column, populated when
+// the rows currently in the fetch buffers were fetched, as well as the number
+// of NULL values found in those rows.
+//-----------------------------------------------------------------------------
+int dpiStmt_getQueryNullBitmap(dpiStmt *stmt, uint32_t pos,
+        const uint64_t **bitmap, uint32_t *numNulls)
+{
+    dpiError error;
+    dpiVar *var;
+
+    if (dpiStmt__checkOpen(stmt, __func__, &error) < 0)
+        return DPI_FAILURE;
+    DPI_CHECK_PTR_NOT_NULL(bitmap)
+    DPI_CHECK_PTR_NOT_NULL(numNulls)
+    if (!stmt->queryVars)
+        return dpiError__set(&error, "check query vars",
+                DPI_ERR_QUERY_NOT_EXECUTED);
+    if (pos == 0 || pos > stmt->numQueryVars)
+        return dpiError__set(&error, "check query position",
+                DPI_ERR_QUERY_POSITION_INVALID, pos);
+    var = stmt->queryVars[pos - 1];
+    if (!var || stmt->bufferRowCount == 0)
+        return dpiError__set(&error, "check fetched row",
+                DPI_ERR_NO_ROW_FETCHED);
+    *bitmap = var->nullBitmap;
+    *numNulls = var->numNulls;
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiStmt_getQueryValue() [PUBLIC]
 //   Get value from query at specified position.
@@ -1646,8 +2234,9 @@ int dpiStmt_scroll(dpiStmt *stmt, dpiFetchMode mode, int32_t offset,
         int32_t rowCountOffset)
 {
     uint32_t numRows, currentPosition;
-    uint64_t desiredRow;
+    uint64_t desiredRow = 0;
     dpiError error;
+    int found;
 
     // make sure the cursor is open
     if (dpiStmt__checkOpen(stmt, __func__, &error) < 0)
@@ -1686,10 +2275,23 @@ int dpiStmt_scroll(dpiStmt *stmt, dpiFetchMode mode, int32_t offset,
         return DPI_SUCCESS;
     }
 
+    // check the blocks of rows previously fetched
+    if (mode != DPI_MODE_FETCH_LAST) {
+        if (dpiStmt__restoreScrollWindow(stmt, desiredRow, &found,
+                &error) < 0)
+            return DPI_FAILURE;
+        if (found)
+            return DPI_SUCCESS;
+    }
+
     // perform any pre-fetch activities required
     if (dpiStmt__preFetch(stmt, &error) < 0)
         return DPI_FAILURE;
 
+    // if a block of rows was restored, the desired row must be fetched using
+    // its absolute position
+    dpiStmt__getFetchMode(stmt, desiredRow, &mode, &offset);
+
     // perform fetch; when fetching the last row, only fetch a single row
     numRows = (mode == DPI_MODE_FETCH_LAST) ? 1 : stmt->fetchArraySize;
     if (dpiOci__stmtFetch2(stmt, numRows, mode, offset, &error) < 0)
@@ -1722,6 +2324,7 @@ int dpiStmt_scroll(dpiStmt *stmt, dpiFetchMode mode, int32_t offset,
     stmt->rowCount = currentPosition - stmt->bufferRowCount;
     stmt->bufferMinRow = stmt->rowCount + 1;
     stmt->bufferRowIndex = 0;
+    dpiStmt__saveScrollWindow(stmt);
 
     // perform post-fetch activities required
     if (dpiStmt__postFetch(stmt, &error) < 0)
@@ -1731,6 +2334,26 @@ int dpiStmt_scroll(dpiStmt *stmt, dpiFetchMode mode, int32_t offset,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiStmt_setAdaptiveFetch() [PUBLIC]
+//   Set the size of the buffers (in bytes) used as the target when adjusting
+// the fetch array size automatically. Using a value of zero disables the
+// adjustment and retains the current fetch array size.
+//-----------------------------------------------------------------------------
+int dpiStmt_setAdaptiveFetch(dpiStmt *stmt, uint32_t bufferSize)
+{
+    dpiError error;
+
+    if (dpiStmt__checkOpen(stmt, __func__, &error) < 0)
+        return DPI_FAILURE;
+    stmt->adaptiveFetchBufferSize = bufferSize;
+    stmt->lastFetchRows = 0;
+    stmt->minRowFetchTime = 0;
+    stmt->adaptiveFetchMaxArraySize = 0;
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiStmt_setFetchArraySize() [PUBLIC]
 //   Set the array size used for fetches. Using a value of zero will select the
@@ -1757,3 +2380,62 @@ int dpiStmt_setFetchArraySize(dpiStmt *stmt, uint32_t arraySize)
     return DPI_SUCCESS;
 }
 
+
+//-----------------------------------------------------------------------------
+// dpiStmt_setInlineLobSize() [PUBLIC]
+//   Set the maximum size (in bytes) of CLOB and BLOB values returned inline
+// with the rows fetched, in place of LOB locators. The values are fetched
+// piecewise, so larger values are also returned, in additional pieces; the
+// size only sets the length of the first piece of each row. There is no upper
+// limit: each value is held in memory in full, however large, so LOBs that
+// may be very large are best fetched as locators. Using a value of zero
+// fetches LOB locators again. The change takes effect when the statement
+// is next executed.
+//-----------------------------------------------------------------------------
+int dpiStmt_setInlineLobSize(dpiStmt *stmt, uint32_t maxSize)
+{
+    dpiError error;
+
+    if (dpiStmt__checkOpen(stmt, __func__, &error) < 0)
+        return DPI_FAILURE;
+    if (maxSize != stmt->inlineLobSize && stmt->numQueryVars > 0)
+        dpiStmt__clearQueryVars(stmt, &error);
+    stmt->inlineLobSize = maxSize;
+    return DPI_SUCCESS;
+}
+
+
+//-----------------------------------------------------------------------------
+// dpiStmt_setPrefetchMemory() [PUBLIC]
+//   Set the amount of memory (in bytes) that OCI may use for prefetching rows
+// when the statement is executed. Using a value of zero removes the limit.
+//-----------------------------------------------------------------------------
+int dpiStmt_setPrefetchMemory(dpiStmt *stmt, uint32_t numBytes)
+{
+    dpiError error;
+
+    if (dpiStmt__checkOpen(stmt, __func__, &error) < 0)
+        return DPI_FAILURE;
+    stmt->prefetchMemory = numBytes;
+    stmt->hasPrefetchMemory = 1;
+    return DPI_SUCCESS;
+}
+
+
+//-----------------------------------------------------------------------------
+// dpiStmt_setPrefetchRows() [PUBLIC]
+//   Set the number of rows that OCI prefetches when the statement is executed
+// and during each subsequent fetch, independently of the fetch array size.
+// Using a value of zero disables prefetching.
+//-----------------------------------------------------------------------------
+int dpiStmt_setPrefetchRows(dpiStmt *stmt, uint32_t numRows)
+{
+    dpiError error;
+
+    if (dpiStmt__checkOpen(stmt, __func__, &error) < 0)
+        return DPI_FAILURE;
+    stmt->prefetchRows = numRows;
+    stmt->hasPrefetchRows = 1;
+    return DPI_SUCCESS;
+}
+
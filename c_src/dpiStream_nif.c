@@ -0,0 +1,141 @@
+// dpiStream_nif.c
+// Cursor de consulta aberto num recurso Erlang. Os blocos de linhas chegam
+// ao processo que abriu o stream como mensagens {ref, bloco}, enviadas pela
+// thread do pipeline de busca; o stream_next confirma cada bloco tratado.
+// O OracleNif.stream/3 monta um Stream em cima destes NIFs, de modo que a
+// memória usada depende só do tamanho do bloco e não do total de linhas da
+// consulta.
+
+#include <string.h>
+#include "dpiStream_nif.h"
+#include "dpiConn_nif.h"
+#include "dpiData_nif.h"
+#include "dpiFetch_nif.h"
+
+typedef struct {
+  ErlNifMutex *lock;
+  fetch_pipeline *pipeline;
+} stream_resource;
+
+static ErlNifResourceType *stream_type;
+static ERL_NIF_TERM atom_ok;
+
+
+// Interrompe o pipeline sem esperar a busca em andamento; o cursor é
+// fechado pela thread de limpeza.
+static void stream_release(stream_resource *res)
+{
+  if (res->pipeline) {
+    fetch_pipeline_stop(res->pipeline);
+    res->pipeline = NULL;
+  }
+}
+
+
+static void stream_dtor(ErlNifEnv *env, void *obj)
+{
+  stream_resource *res = obj;
+
+  stream_release(res);
+  if (res->lock)
+    enif_mutex_destroy(res->lock);
+}
+
+
+int stream_load(ErlNifEnv *env)
+{
+  stream_type = enif_open_resource_type(env, NULL, "oracle_nif_stream",
+      stream_dtor, ERL_NIF_RT_CREATE, NULL);
+  if (!stream_type)
+    return -1;
+  atom_ok = enif_make_atom(env, "ok");
+  return 0;
+}
+
+
+// stream_open(conn, sql, linhas por busca) -> {:ok, stream, ref} |
+// {:error, msg}. A busca começa na hora: os dois primeiros blocos já são
+// buscados enquanto o processo se prepara para recebê-los.
+ERL_NIF_TERM stream_open(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  data_encoder *encoders = NULL;
+  uint32_t numColumns;
+  stream_resource *res;
+  unsigned arraySize;
+  dpiStmt *stmt = NULL;
+  ERL_NIF_TERM term, ref;
+  ErlNifBinary sql;
+  dpiConn *conn;
+
+  if (!conn_get_conn(env, argv[0], &conn) ||
+      !enif_inspect_binary(env, argv[1], &sql) ||
+      !enif_get_uint(env, argv[2], &arraySize) || arraySize == 0)
+    return enif_make_badarg(env);
+
+  res = enif_alloc_resource(stream_type, sizeof(stream_resource));
+  if (!res)
+    return enif_make_badarg(env);
+  memset(res, 0, sizeof(stream_resource));
+  res->lock = enif_mutex_create("oracle_nif_stream_lock");
+  if (!res->lock) {
+    enif_release_resource(res);
+    return enif_make_badarg(env);
+  }
+
+  if (dpiConn_prepareStmt(conn, 0, (const char*) sql.data, sql.size,
+          NULL, 0, &stmt) < 0 ||
+      dpiStmt_setFetchArraySize(stmt, arraySize) < 0 ||
+      dpiStmt_execute(stmt, DPI_MODE_EXEC_DEFAULT, &numColumns) < 0 ||
+      data_encoders_create(stmt, numColumns, &encoders) < 0) {
+    term = conn_make_error(env);
+    if (stmt)
+      dpiStmt_release(stmt);
+    enif_release_resource(res);
+    return term;
+  }
+
+  ref = enif_make_ref(env);
+  res->pipeline = fetch_pipeline_start(conn_context(), stmt, numColumns,
+      encoders, arraySize, env, ref);
+  if (!res->pipeline) {
+    data_encoders_free(encoders);
+    dpiStmt_release(stmt);
+    enif_release_resource(res);
+    return enif_make_badarg(env);
+  }
+
+  term = enif_make_resource(env, res);
+  enif_release_resource(res);
+  return enif_make_tuple3(env, atom_ok, term, ref);
+}
+
+
+// stream_next(stream) -> :ok. Confirma que um bloco recebido foi tratado,
+// liberando a thread para buscar o próximo.
+ERL_NIF_TERM stream_next(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  stream_resource *res;
+
+  if (!enif_get_resource(env, argv[0], stream_type, (void**) &res))
+    return enif_make_badarg(env);
+  enif_mutex_lock(res->lock);
+  if (res->pipeline)
+    fetch_pipeline_ack(res->pipeline);
+  enif_mutex_unlock(res->lock);
+  return atom_ok;
+}
+
+
+// stream_close(stream) -> :ok. Depois dele nenhum bloco novo é enviado; o
+// cursor é liberado em segundo plano, sem esperar o GC.
+ERL_NIF_TERM stream_close(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+{
+  stream_resource *res;
+
+  if (!enif_get_resource(env, argv[0], stream_type, (void**) &res))
+    return enif_make_badarg(env);
+  enif_mutex_lock(res->lock);
+  stream_release(res);
+  enif_mutex_unlock(res->lock);
+  return atom_ok;
+}
@@ -0,0 +1,13 @@
+#ifndef DPISTREAM_NIF_H
+#define DPISTREAM_NIF_H
+
+#include <erl_nif.h>
+#include "dpi.h"
+
+int stream_load(ErlNifEnv *env);
+
+ERL_NIF_TERM stream_open(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM stream_next(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]);
+ERL_NIF_TERM stream_close(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[]);
+
+#endif
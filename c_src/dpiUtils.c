@@ -14,6 +14,12 @@
 //   Utility methods that aren't specific to a particular type.
 //-----------------------------------------------------------------------------
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
 #include "dpiImpl.h"
 
 //-----------------------------------------------------------------------------
@@ -53,6 +59,28 @@ int dpiUtils__getAttrStringWithDup(const char *action, const void *ociHandle,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiUtils__getMonotonicTime() [INTERNAL]
+//   Return the value of a monotonic clock in microseconds. The value is only
+// meaningful when compared with other values returned by this routine.
+//-----------------------------------------------------------------------------
+uint64_t dpiUtils__getMonotonicTime(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t) (counter.QuadPart * 1000000 / frequency.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+#endif
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiUtils__parseNumberString() [INTERNAL]
 //   Parse the contents of a string that is supposed to contain a number. The
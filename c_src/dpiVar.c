@@ -32,6 +32,8 @@ static int dpiVar__setFromRowid(dpiVar *var, uint32_t pos, dpiRowid *rowid,
         dpiError *error);
 static int dpiVar__setFromStmt(dpiVar *var, uint32_t pos, dpiStmt *stmt,
         dpiError *error);
+static void dpiVar__setNullBitmap(dpiVar *var, uint32_t start,
+        uint32_t end);
 static int dpiVar__validateTypes(const dpiOracleType *oracleType,
         dpiNativeTypeNum nativeTypeNum, dpiError *error);
 
@@ -168,17 +170,35 @@ static int dpiVar__allocateBuffers(dpiVar *var, dpiError *error)
             var->indicator[i] = DPI_OCI_IND_NULL;
     }
 
+    // allocate the bitmap of null values populated after each conversion
+    if (!var->nullBitmap) {
+        var->nullBitmap = calloc((var->maxArraySize + 63) / 64,
+                sizeof(uint64_t));
+        if (!var->nullBitmap)
+            return dpiError__set(error, "allocate null bitmap",
+                    DPI_ERR_NO_MEMORY);
+    }
+
     // allocate the actual length buffers for all but dynamic bytes which are
-    // handled differently; ensure actual length starts out as maximum value
+    // handled differently; ensure actual length starts out as maximum value;
+    // the 16-bit array is only needed by 11g clients, which also need a 32-bit
+    // array while the variable is bound dynamically (see
+    // dpiVar__convertToLength32())
     if (!var->isDynamic && !var->actualLength16 && !var->actualLength32) {
         if (var->env->versionInfo->versionNum < 12) {
             var->actualLength16 = (uint16_t*)
                     malloc(var->maxArraySize * sizeof(uint16_t));
+            if (!var->actualLength16)
+                return dpiError__set(error, "allocate actual lengths",
+                        DPI_ERR_NO_MEMORY);
             for (i = 0; i < var->maxArraySize; i++)
                 var->actualLength16[i] = var->sizeInBytes;
         } else {
             var->actualLength32 = (uint32_t*)
                     malloc(var->maxArraySize * sizeof(uint32_t));
+            if (!var->actualLength32)
+                return dpiError__set(error, "allocate actual lengths",
+                        DPI_ERR_NO_MEMORY);
             for (i = 0; i < var->maxArraySize; i++)
                 var->actualLength32[i] = var->sizeInBytes;
         }
@@ -386,6 +406,31 @@ int dpiVar__convertToLob(dpiVar *var, dpiError *error)
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiVar__convertToLength32() [INTERNAL]
+//   Add a 32-bit actual length array to a variable using the 16-bit array of
+// the 11g bind and define calls. Callbacks used for dynamic binds always work
+// with 32-bit lengths so variables bound that way switch to the 32-bit array
+// once at bind time instead of copying lengths between the two arrays for
+// every value. The 16-bit array is kept since the variable may later be bound
+// without callbacks again (see dpiVar__restoreLength16()).
+//-----------------------------------------------------------------------------
+int dpiVar__convertToLength32(dpiVar *var, dpiError *error)
+{
+    uint32_t i;
+
+    if (!var->actualLength16 || var->actualLength32)
+        return DPI_SUCCESS;
+    var->actualLength32 = malloc(var->maxArraySize * sizeof(uint32_t));
+    if (!var->actualLength32)
+        return dpiError__set(error, "allocate actual lengths",
+                DPI_ERR_NO_MEMORY);
+    for (i = 0; i < var->maxArraySize; i++)
+        var->actualLength32[i] = var->actualLength16[i];
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiVar__copyData() [INTERNAL]
 //   Copy the data from the source to the target variable at the given array
@@ -451,7 +496,9 @@ int32_t dpiVar__defineCallback(dpiVar *var, void *defnp, uint32_t iter,
     // allocate memory for the chunk, if needed
     chunk = &bytes->chunks[bytes->numChunks];
     if (!chunk->ptr) {
-        chunk->allocatedLength = DPI_DYNAMIC_BYTES_CHUNK_SIZE;
+        chunk->allocatedLength = (bytes->numChunks == 0 &&
+                var->dynamicChunkSize > 0) ? var->dynamicChunkSize :
+                DPI_DYNAMIC_BYTES_CHUNK_SIZE;
         chunk->ptr = malloc(chunk->allocatedLength);
         if (!chunk->ptr) {
             dpiError__set(var->error, "allocate buffer", DPI_ERR_NO_MEMORY);
@@ -542,6 +589,7 @@ int dpiVar__extendedPreFetch(dpiVar *var, dpiError *error)
     dpiStmt *stmt;
     dpiLob *lob;
     uint32_t i;
+    int reused;
 
     if (var->isDynamic) {
         for (i = 0; i < var->maxArraySize; i++)
@@ -553,12 +601,26 @@ int dpiVar__extendedPreFetch(dpiVar *var, dpiError *error)
         case DPI_ORACLE_TYPE_STMT:
             for (i = 0; i < var->maxArraySize; i++) {
                 data = &var->externalData[i];
+                var->data.asStmt[i] = NULL;
+                data->value.asStmt = NULL;
+
+                // a statement from the previous fetch that is referenced only
+                // by the variable is kept; its handle is replaced, which
+                // closes the previous cursor on the server
+                stmt = var->references[i].asStmt;
+                if (stmt && stmt->refCount == 1 && stmt->isOwned &&
+                        stmt->handle) {
+                    if (dpiStmt__reset(stmt, error) < 0)
+                        return DPI_FAILURE;
+                    var->data.asStmt[i] = stmt->handle;
+                    data->value.asStmt = stmt;
+                    continue;
+                }
+
                 if (var->references[i].asStmt) {
                     dpiGen__setRefCount(var->references[i].asStmt, error, -1);
                     var->references[i].asStmt = NULL;
                 }
-                var->data.asStmt[i] = NULL;
-                data->value.asStmt = NULL;
                 if (dpiStmt__allocate(var->conn, 0, &stmt, error) < 0)
                     return DPI_FAILURE;
                 var->references[i].asStmt = stmt;
@@ -590,11 +652,13 @@ int dpiVar__extendedPreFetch(dpiVar *var, dpiError *error)
                 if (dpiLob__allocate(var->conn, var->type, &lob, error) < 0)
                     return DPI_FAILURE;
                 var->references[i].asLOB = lob;
-                var->data.asLobLocator[i] = lob->locator;
                 data->value.asLOB = lob;
+                // the temporary LOB is overwritten by dpiLob__setFromBytes()
+                // so a reused one does not need to be emptied
                 if (var->dynamicBytes &&
-                        dpiOci__lobCreateTemporary(lob, error) < 0)
+                        dpiLob__createTemporary(lob, &reused, error) < 0)
                     return DPI_FAILURE;
+                var->data.asLobLocator[i] = lob->locator;
             }
             break;
         case DPI_ORACLE_TYPE_ROWID:
@@ -706,6 +770,10 @@ static void dpiVar__finalizeBuffers(dpiVar *var, dpiError *error)
         free(var->indicator);
         var->indicator = NULL;
     }
+    if (var->nullBitmap) {
+        free(var->nullBitmap);
+        var->nullBitmap = NULL;
+    }
     if (var->returnCode) {
         free(var->returnCode);
         var->returnCode = NULL;
@@ -786,10 +854,6 @@ int dpiVar__getValue(dpiVar *var, uint32_t pos, dpiData *data,
         }
     }
 
-    // for 11g, dynamic lengths are 32-bit whereas static lengths are 16-bit
-    if (var->actualLength16 && var->actualLength32)
-        var->actualLength16[pos] = (uint16_t) var->actualLength32[pos];
-
     // transform the various types
     oracleTypeNum = var->type->oracleTypeNum;
     switch (var->nativeTypeNum) {
@@ -843,9 +907,9 @@ int dpiVar__getValue(dpiVar *var, uint32_t pos, dpiData *data,
                     if (var->dynamicBytes)
                         return dpiVar__setBytesFromDynamicBytes(var, bytes,
                                 &var->dynamicBytes[pos], error);
-                    if (var->actualLength16)
-                        bytes->length = var->actualLength16[pos];
-                    else bytes->length = var->actualLength32[pos];
+                    if (var->actualLength32)
+                        bytes->length = var->actualLength32[pos];
+                    else bytes->length = var->actualLength16[pos];
                     return DPI_SUCCESS;
                 case DPI_ORACLE_TYPE_CLOB:
                 case DPI_ORACLE_TYPE_NCLOB:
@@ -900,6 +964,121 @@ int dpiVar__getValue(dpiVar *var, uint32_t pos, dpiData *data,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiVar__getValues() [INTERNAL]
+//   Transform the values in the given range of the variable's buffers into
+// the external data structures. The conversion is resolved once for the whole
+// range so that fixed width types can be handled by simple loops; all other
+// types are transformed one position at a time.
+//-----------------------------------------------------------------------------
+int dpiVar__getValues(dpiVar *var, uint32_t start, uint32_t count,
+        dpiError *error)
+{
+    dpiOracleTypeNum oracleTypeNum;
+    uint32_t i, pos, end;
+    dpiData *data;
+
+    // objects keep their indicator elsewhere and variables that are not
+    // handled below require the generic transformation
+    end = start + count;
+    data = var->externalData;
+    oracleTypeNum = var->type->oracleTypeNum;
+    if (var->objectIndicator || var->dynamicBytes)
+        oracleTypeNum = DPI_ORACLE_TYPE_NONE;
+
+    // check for NULL values; for objects the indicator is elsewhere
+    if (var->objectIndicator) {
+        for (i = start; i < end; i++)
+            data[i].isNull = (!var->objectIndicator[i] ||
+                    *((int16_t*) var->objectIndicator[i]) ==
+                    DPI_OCI_IND_NULL);
+    } else {
+        for (i = start; i < end; i++)
+            data[i].isNull = (var->indicator[i] == DPI_OCI_IND_NULL);
+    }
+    dpiVar__setNullBitmap(var, start, end);
+
+    // check return code for variable length data
+    if (var->returnCode) {
+        for (i = start; i < end; i++) {
+            if (!data[i].isNull && var->returnCode[i] != 0) {
+                dpiError__set(error, "check return code",
+                        DPI_ERR_COLUMN_FETCH, i, var->returnCode[i]);
+                error->buffer->code = var->returnCode[i];
+                return DPI_FAILURE;
+            }
+        }
+    }
+
+    // transform the fixed width types; values in NULL positions are ignored
+    switch (var->nativeTypeNum) {
+        case DPI_NATIVE_TYPE_INT64:
+        case DPI_NATIVE_TYPE_UINT64:
+            if (oracleTypeNum != DPI_ORACLE_TYPE_NATIVE_INT &&
+                    oracleTypeNum != DPI_ORACLE_TYPE_NATIVE_UINT)
+                break;
+            for (i = start; i < end; i++)
+                data[i].value.asInt64 = var->data.asInt64[i];
+            return DPI_SUCCESS;
+        case DPI_NATIVE_TYPE_DOUBLE:
+            if (oracleTypeNum != DPI_ORACLE_TYPE_NATIVE_DOUBLE)
+                break;
+            for (i = start; i < end; i++)
+                data[i].value.asDouble = var->data.asDouble[i];
+            return DPI_SUCCESS;
+        case DPI_NATIVE_TYPE_FLOAT:
+            for (i = start; i < end; i++)
+                data[i].value.asFloat = var->data.asFloat[i];
+            return DPI_SUCCESS;
+        case DPI_NATIVE_TYPE_BOOLEAN:
+            for (i = start; i < end; i++)
+                data[i].value.asBoolean = var->data.asBoolean[i];
+            return DPI_SUCCESS;
+        case DPI_NATIVE_TYPE_TIMESTAMP:
+            if (oracleTypeNum != DPI_ORACLE_TYPE_DATE)
+                break;
+            for (i = start; i < end; i++) {
+                if (!data[i].isNull)
+                    dpiData__fromOracleDate(&data[i], &var->data.asDate[i]);
+            }
+            return DPI_SUCCESS;
+        case DPI_NATIVE_TYPE_BYTES:
+            switch (oracleTypeNum) {
+                case DPI_ORACLE_TYPE_VARCHAR:
+                case DPI_ORACLE_TYPE_NVARCHAR:
+                case DPI_ORACLE_TYPE_CHAR:
+                case DPI_ORACLE_TYPE_NCHAR:
+                case DPI_ORACLE_TYPE_ROWID:
+                case DPI_ORACLE_TYPE_RAW:
+                case DPI_ORACLE_TYPE_LONG_VARCHAR:
+                case DPI_ORACLE_TYPE_LONG_RAW:
+                    if (var->actualLength32) {
+                        for (i = start; i < end; i++)
+                            data[i].value.asBytes.length =
+                                    var->actualLength32[i];
+                    } else {
+                        for (i = start; i < end; i++)
+                            data[i].value.asBytes.length =
+                                    var->actualLength16[i];
+                    }
+                    return DPI_SUCCESS;
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+
+    // all other types are transformed individually
+    for (pos = start; pos < end; pos++) {
+        if (dpiVar__getValue(var, pos, &data[pos], error) < 0)
+            return DPI_FAILURE;
+    }
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiVar__inBindCallback() [INTERNAL]
 //   Callback which runs during OCI statement execution and provides buffers to
@@ -923,10 +1102,10 @@ int32_t dpiVar__inBindCallback(dpiVar *var, void *bindp, uint32_t iter,
         }
     } else {
         dpiVar__assignCallbackBuffer(var, index, bufpp);
-        if (var->actualLength16)
-            *alenp = var->actualLength16[index];
-        else if (var->actualLength32)
+        if (var->actualLength32)
             *alenp = var->actualLength32[index];
+        else if (var->actualLength16)
+            *alenp = var->actualLength16[index];
         else *alenp = var->type->sizeInBytes;
     }
     *piecep = DPI_OCI_ONE_PIECE;
@@ -974,6 +1153,8 @@ int32_t dpiVar__outBindCallback(dpiVar *var, void *bindp, uint32_t iter,
             var->maxArraySize = numRowsReturned;
             if (dpiVar__initBuffers(var, var->error) < 0)
                 return DPI_OCI_ERROR;
+            if (dpiVar__convertToLength32(var, var->error) < 0)
+                return DPI_OCI_ERROR;
         }
 
         // set actual array size to number of rows returned
@@ -984,15 +1165,7 @@ int32_t dpiVar__outBindCallback(dpiVar *var, void *bindp, uint32_t iter,
     // assign pointers used by OCI
     *piecep = DPI_OCI_ONE_PIECE;
     dpiVar__assignCallbackBuffer(var, index, bufpp);
-    if (var->actualLength32 || var->actualLength16) {
-        if (!var->actualLength32) {
-            var->actualLength32 = calloc(var->maxArraySize, sizeof(uint32_t));
-            if (!var->actualLength32) {
-                dpiError__set(var->error, "allocate lengths for 11g",
-                        DPI_ERR_NO_MEMORY);
-                return DPI_OCI_ERROR;
-            }
-        }
+    if (var->actualLength32) {
         var->actualLength32[index] = var->sizeInBytes;
         *alenpp = &(var->actualLength32[index]);
     } else if (*alenpp && var->type->sizeInBytes)
@@ -1005,6 +1178,25 @@ int32_t dpiVar__outBindCallback(dpiVar *var, void *bindp, uint32_t iter,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiVar__restoreLength16() [INTERNAL]
+//   Return to the 16-bit actual length array when a variable that was bound
+// dynamically on an 11g client is bound without callbacks again. The lengths
+// are copied back and the 32-bit array is freed.
+//-----------------------------------------------------------------------------
+void dpiVar__restoreLength16(dpiVar *var)
+{
+    uint32_t i;
+
+    if (!var->actualLength16 || !var->actualLength32)
+        return;
+    for (i = 0; i < var->maxArraySize; i++)
+        var->actualLength16[i] = (uint16_t) var->actualLength32[i];
+    free(var->actualLength32);
+    var->actualLength32 = NULL;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiVar__setBytesFromDynamicBytes() [PRIVATE]
 //   Set the pointer and length in the dpiBytes structure to the values
@@ -1307,6 +1499,37 @@ static int dpiVar__setFromStmt(dpiVar *var, uint32_t pos, dpiStmt *stmt,
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiVar__setNullBitmap() [PRIVATE]
+//   Populate the bits of the null bitmap for the given range of positions
+// from the external data structures and count the number of NULL values found
+// in that range. Each word is computed from the NULL flags without branching
+// so that the compiler is able to vectorize the inner loop.
+//-----------------------------------------------------------------------------
+static void dpiVar__setNullBitmap(dpiVar *var, uint32_t start, uint32_t end)
+{
+    uint32_t i, wordStart, wordEnd, numNulls = 0;
+    uint64_t bits, mask;
+    dpiData *data;
+
+    data = var->externalData;
+    for (wordStart = start & ~63u; wordStart < end; wordStart += 64) {
+        wordEnd = (end - wordStart > 64) ? wordStart + 64 : end;
+        i = (wordStart < start) ? start : wordStart;
+        mask = 0;
+        bits = 0;
+        for (; i < wordEnd; i++) {
+            mask |= (uint64_t) 1 << (i - wordStart);
+            bits |= (uint64_t) (data[i].isNull != 0) << (i - wordStart);
+            numNulls += (data[i].isNull != 0);
+        }
+        var->nullBitmap[wordStart / 64] =
+                (var->nullBitmap[wordStart / 64] & ~mask) | bits;
+    }
+    var->numNulls = numNulls;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiVar__setValue() [PRIVATE]
 //   Sets the contents of the variable using the type specified, if possible.
@@ -1456,6 +1679,31 @@ int dpiVar_addRef(dpiVar *var)
 }
 
 
+//-----------------------------------------------------------------------------
+// dpiVar_convertRange() [PUBLIC]
+//   Transform the values found in the given range of the variable's buffers
+// and return a pointer to the first of the dpiData structures populated. The
+// structures are the same ones returned by dpiVar_getData().
+//-----------------------------------------------------------------------------
+int dpiVar_convertRange(dpiVar *var, uint32_t start, uint32_t count,
+        dpiData **data)
+{
+    dpiError error;
+
+    if (dpiGen__startPublicFn(var, DPI_HTYPE_VAR, __func__, &error) < 0)
+        return DPI_FAILURE;
+    DPI_CHECK_PTR_NOT_NULL(data)
+    if (start > var->maxArraySize || count > var->maxArraySize - start)
+        return dpiError__set(&error, "check range",
+                DPI_ERR_INVALID_ARRAY_POSITION, start + count,
+                var->maxArraySize);
+    if (count > 0 && dpiVar__getValues(var, start, count, &error) < 0)
+        return DPI_FAILURE;
+    *data = &var->externalData[start];
+    return DPI_SUCCESS;
+}
+
+
 //-----------------------------------------------------------------------------
 // dpiVar_copyData() [PUBLIC]
 //   Copy the data from the source variable to the target variable at the given
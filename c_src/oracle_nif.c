@@ -5,8 +5,16 @@
 
 #include <erl_nif.h>
 #include "somar_nif.h"
+#include "dpiCleanup_nif.h"
 #include "dpiConn_nif.h"
+#include "dpiConnPool_nif.h"
 #include "dpiContext_nif.h"
+#include "dpiData_nif.h"
+#include "dpiImplicit_nif.h"
+#include "dpiLob_nif.h"
+#include "dpiParallel_nif.h"
+#include "dpiPool_nif.h"
+#include "dpiStream_nif.h"
 
 
 // static ERL_NIF_TERM somar_nif(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
@@ -21,8 +29,45 @@
 
 static ErlNifFunc nif_funcs[] = {
   {"somar", 2, somar_nif},
+  {"get_conn", 3, getConn, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"conn_set_inline_lob_size", 2, conn_set_inline_lob_size},
+  {"stream_open", 3, stream_open, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"stream_next", 1, stream_next},
+  {"stream_close", 1, stream_close},
+  {"implicit_results", 3, implicit_results, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"pool_create", 4, pool_create, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"pool_metrics", 1, pool_metrics},
+  {"pool_warmup", 2, pool_warmup, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"parallel_query", 2, parallel_query, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"parallel_scan_open", 4, parallel_scan_open, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"parallel_scan_next", 1, parallel_scan_next},
+  {"parallel_scan_close", 1, parallel_scan_close},
+  {"conn_pool_create", 2, conn_pool_create, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"conn_pool_checkout", 1, conn_pool_checkout},
+  {"conn_pool_checkout", 2, conn_pool_checkout},
+  {"conn_pool_checkin", 1, conn_pool_checkin},
+  {"conn_pool_checkin", 2, conn_pool_checkin},
+  {"lob_stream_open", 2, lob_stream_open, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"lob_stream_next", 1, lob_stream_next, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"lob_stream_close", 1, lob_stream_close},
+  {"lob_read", 2, lob_read, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"lob_writer_open", 2, lob_writer_open, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"lob_writer_write", 2, lob_writer_write, ERL_NIF_DIRTY_JOB_IO_BOUND},
+  {"lob_writer_close", 1, lob_writer_close, ERL_NIF_DIRTY_JOB_IO_BOUND},
 
 };
 
-ERL_NIF_INIT(Elixir.OracleNif, nif_funcs, NULL, NULL, NULL, NULL)
+// Executado quando a biblioteca é carregada pelo :erlang.load_nif
+static int load(ErlNifEnv* env, void** priv_data, ERL_NIF_TERM load_info)
+{
+  if (cleanup_load(env) != 0 || data_load(env) != 0 ||
+      conn_load(env) != 0 || stream_load(env) != 0 ||
+      pool_load(env) != 0 || parallel_load(env) != 0 ||
+      conn_pool_load(env) != 0 || lob_load(env) != 0 ||
+      implicit_load(env) != 0)
+    return -1;
+  return 0;
+}
+
+ERL_NIF_INIT(Elixir.OracleNif, nif_funcs, load, NULL, NULL, NULL)
 
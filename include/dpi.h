@@ -84,6 +84,11 @@
 // define maximum precision that can be supported by an int64_t value
 #define DPI_MAX_INT64_PRECISION                 18
 
+// define number of buckets in the pool acquire wait time histogram; bucket n
+// counts waits of less than 2^n microseconds (and at least 2^(n-1)) and the
+// last bucket also counts all longer waits
+#define DPI_POOL_WAIT_BUCKETS                   24
+
 // define constants for success and failure of methods
 #define DPI_SUCCESS                             0
 #define DPI_FAILURE                             -1
@@ -172,6 +177,13 @@ typedef enum {
     DPI_MODE_FETCH_RELATIVE = 0x00000040        // OCI_FETCH_RELATIVE
 } dpiFetchMode;
 
+// pieces of a LOB written piecewise
+typedef enum {
+    DPI_LOB_PIECE_FIRST = 1,                    // OCI_FIRST_PIECE
+    DPI_LOB_PIECE_NEXT = 2,                     // OCI_NEXT_PIECE
+    DPI_LOB_PIECE_LAST = 3                      // OCI_LAST_PIECE
+} dpiLobPiece;
+
 // message delivery modes in advanced queuing
 typedef enum {
     DPI_MODE_MSG_PERSISTENT = 1,                // OCI_MSG_PERSISTENT
@@ -401,6 +413,7 @@ typedef struct dpiErrorInfo dpiErrorInfo;
 typedef struct dpiObjectAttrInfo dpiObjectAttrInfo;
 typedef struct dpiObjectTypeInfo dpiObjectTypeInfo;
 typedef struct dpiPoolCreateParams dpiPoolCreateParams;
+typedef struct dpiPoolMetrics dpiPoolMetrics;
 typedef struct dpiQueryInfo dpiQueryInfo;
 typedef struct dpiStmtInfo dpiStmtInfo;
 typedef struct dpiSubscrCreateParams dpiSubscrCreateParams;
@@ -451,6 +464,7 @@ struct dpiConnCreateParams {
     const char *outTag;
     uint32_t outTagLength;
     int outTagFound;
+    int outNewSession;
 };
 
 // structure used for transferring data to/from ODPI-C
@@ -530,6 +544,22 @@ struct dpiPoolCreateParams {
     uint32_t outPoolNameLength;
 };
 
+// structure used for transferring pool usage statistics from ODPI-C; times
+// are in microseconds
+struct dpiPoolMetrics {
+    uint64_t numAcquires;
+    uint64_t numAcquireFailures;
+    uint64_t numAcquireTimeouts;
+    uint64_t acquireWaitTotal;
+    uint64_t acquireWaitMax;
+    uint64_t acquireWaitBuckets[DPI_POOL_WAIT_BUCKETS];
+    uint64_t numSessionsCreated;
+    uint64_t sessionCreateTotal;
+    uint64_t sessionCreateMax;
+    uint64_t numTagRequests;
+    uint64_t numTagMatches;
+};
+
 // structure used for transferring query metadata from ODPI-C
 struct dpiQueryInfo {
     const char *name;
@@ -726,6 +756,9 @@ int dpiConn_getHandle(dpiConn *conn, void **handle);
 int dpiConn_getInternalName(dpiConn *conn, const char **value,
         uint32_t *valueLength);
 
+// return whether the connection is still usable, without a round trip
+int dpiConn_getIsHealthy(dpiConn *conn, int *isHealthy);
+
 // get logical transaction id associated with the connection
 int dpiConn_getLTXID(dpiConn *conn, const char **value, uint32_t *valueLength);
 
@@ -765,6 +798,9 @@ int dpiConn_newVar(dpiConn *conn, dpiOracleTypeNum oracleTypeNum,
 // ping the connection to see if it is still alive
 int dpiConn_ping(dpiConn *conn);
 
+// ping the connection, limiting the wait for the reply (in milliseconds)
+int dpiConn_pingWithTimeout(dpiConn *conn, uint32_t timeout);
+
 // prepare a distributed transaction for commit
 int dpiConn_prepareDistribTrans(dpiConn *conn, int *commitNeeded);
 
@@ -801,6 +837,10 @@ int dpiConn_setDbOp(dpiConn *conn, const char *value, uint32_t valueLength);
 int dpiConn_setExternalName(dpiConn *conn, const char *value,
         uint32_t valueLength);
 
+// set the default size of the first piece of LOB values fetched inline (in
+// place of locators) by statements created with the connection
+int dpiConn_setInlineLobSize(dpiConn *conn, uint32_t maxSize);
+
 // set internal name associated with the connection
 int dpiConn_setInternalName(dpiConn *conn, const char *value,
         uint32_t valueLength);
@@ -808,6 +848,14 @@ int dpiConn_setInternalName(dpiConn *conn, const char *value,
 // set module associated with the connection
 int dpiConn_setModule(dpiConn *conn, const char *value, uint32_t valueLength);
 
+// set the default amount of memory (in bytes) used for prefetching rows by
+// statements created with the connection
+int dpiConn_setPrefetchMemory(dpiConn *conn, uint32_t numBytes);
+
+// set the default number of rows prefetched by statements created with the
+// connection, in place of the fetch array size
+int dpiConn_setPrefetchRows(dpiConn *conn, uint32_t numRows);
+
 // set the statement cache size
 int dpiConn_setStmtCacheSize(dpiConn *conn, uint32_t cacheSize);
 
@@ -1073,6 +1121,11 @@ int dpiLob_trim(dpiLob *lob, uint64_t newSize);
 int dpiLob_writeBytes(dpiLob *lob, uint64_t offset, const char *value,
         uint64_t valueLength);
 
+// write one piece of data to the LOB; the whole value is written starting at
+// the offset given with the first piece, without knowing its total length
+int dpiLob_writePiece(dpiLob *lob, uint64_t offset, const char *value,
+        uint64_t valueLength, dpiLobPiece piece);
+
 
 //-----------------------------------------------------------------------------
 // Message Properties Methods (dpiMsgProps)
@@ -1270,6 +1323,9 @@ int dpiPool_getGetMode(dpiPool *pool, dpiPoolGetMode *value);
 // get the pool's maximum lifetime session
 int dpiPool_getMaxLifetimeSession(dpiPool *pool, uint32_t *value);
 
+// get the statistics gathered on acquires from the pool
+int dpiPool_getMetrics(dpiPool *pool, dpiPoolMetrics *metrics);
+
 // get the pool's open count
 int dpiPool_getOpenCount(dpiPool *pool, uint32_t *value);
 
@@ -1370,6 +1426,11 @@ int dpiStmt_getFetchArraySize(dpiStmt *stmt, uint32_t *arraySize);
 // get next implicit result from previous execution; NULL if no more exist
 int dpiStmt_getImplicitResult(dpiStmt *stmt, dpiStmt **implicitResult);
 
+// get all implicit results (up to numResults) from previous execution, with
+// the first fetch of each already performed
+int dpiStmt_getImplicitResults(dpiStmt *stmt, uint32_t *numResults,
+        dpiStmt **implicitResults);
+
 // return information about the statement
 int dpiStmt_getInfo(dpiStmt *stmt, dpiStmtInfo *info);
 
@@ -1379,6 +1440,12 @@ int dpiStmt_getNumQueryColumns(dpiStmt *stmt, uint32_t *numQueryColumns);
 // return metadata about the column at the specified position (1 based)
 int dpiStmt_getQueryInfo(dpiStmt *stmt, uint32_t pos, dpiQueryInfo *info);
 
+// get a bitmap of the NULL values for the specified column in the rows
+// currently held in the fetch buffers (bit n of word n / 64 refers to the
+// buffer row index n) and the number of those rows that are NULL
+int dpiStmt_getQueryNullBitmap(dpiStmt *stmt, uint32_t pos,
+        const uint64_t **bitmap, uint32_t *numNulls);
+
 // get the value for the specified column of the current row fetched
 int dpiStmt_getQueryValue(dpiStmt *stmt, uint32_t pos,
         dpiNativeTypeNum *nativeTypeNum, dpiData **data);
@@ -1404,9 +1471,26 @@ int dpiStmt_release(dpiStmt *stmt);
 int dpiStmt_scroll(dpiStmt *stmt, dpiFetchMode mode, int32_t offset,
         int32_t rowCountOffset);
 
+// set the size of the buffers (in bytes) that the fetch array size is
+// adjusted to after each fetch, based on the size of each row and the time
+// taken per row by the previous fetch; zero disables adjustment
+int dpiStmt_setAdaptiveFetch(dpiStmt *stmt, uint32_t bufferSize);
+
 // set the number of rows to (internally) fetch at one time
 int dpiStmt_setFetchArraySize(dpiStmt *stmt, uint32_t arraySize);
 
+// fetch CLOB and BLOB values inline, in place of locators, starting with a
+// piece of the given size; zero fetches locators
+int dpiStmt_setInlineLobSize(dpiStmt *stmt, uint32_t maxSize);
+
+// set the amount of memory (in bytes) used for prefetching rows; zero
+// removes the limit
+int dpiStmt_setPrefetchMemory(dpiStmt *stmt, uint32_t numBytes);
+
+// set the number of rows prefetched by OCI, independently of the fetch array
+// size; zero disables prefetching
+int dpiStmt_setPrefetchRows(dpiStmt *stmt, uint32_t numRows);
+
 
 //-----------------------------------------------------------------------------
 // Rowid Methods (dpiRowid)
@@ -1448,6 +1532,10 @@ int dpiSubscr_release(dpiSubscr *subscr);
 // add a reference to the variable
 int dpiVar_addRef(dpiVar *var);
 
+// convert a range of values in the variable's buffers to dpiData structures
+int dpiVar_convertRange(dpiVar *var, uint32_t start, uint32_t count,
+        dpiData **data);
+
 // copy the data from one variable to another variable
 int dpiVar_copyData(dpiVar *var, uint32_t pos, dpiVar *sourceVar,
         uint32_t sourcePos);
@@ -11,5 +11,277 @@ defmodule OracleNif do
     raise "NIF somar not implemented"
   end
 
+  def get_conn(_user, _password, _connect_string) do
+    raise "NIF get_conn not implemented"
+  end
+
+  ## CLOBs e BLOBs vêm junto com as linhas das próximas consultas da conexão,
+  ## como binários; valores de até `size` bytes vêm numa única parte e os
+  ## maiores em partes adicionais. Não há limite de tamanho: cada LOB vem
+  ## inteiro para a memória, por maior que seja; colunas que podem ter LOBs
+  ## muito grandes devem ser lidas com localizadores. 0 volta a buscar
+  ## localizadores.
+  def conn_set_inline_lob_size(_conn, _size) do
+    raise "NIF conn_set_inline_lob_size not implemented"
+  end
+
+  ## Percorre o resultado da consulta sob demanda, buscando `rows_per_fetch`
+  ## linhas por vez; o cursor é fechado ao fim do Stream (ou se ele for
+  ## interrompido). Os blocos chegam como mensagens ao processo que abriu o
+  ## Stream, que deve ser o mesmo que o consome.
+  def stream(conn, sql, rows_per_fetch \\ 1000) do
+    Stream.resource(
+      fn ->
+        case stream_open(conn, sql, rows_per_fetch) do
+          {:ok, stream, ref} -> {stream, ref}
+          {:error, message} -> raise message
+        end
+      end,
+      fn
+        {stream, nil} ->
+          {:halt, {stream, nil}}
+
+        {stream, ref} ->
+          receive do
+            {^ref, {:rows, rows}} ->
+              stream_next(stream)
+              {rows, {stream, ref}}
+
+            {^ref, {:last, rows}} ->
+              {rows, {stream, nil}}
+
+            {^ref, {:error, message}} ->
+              raise message
+          end
+      end,
+      fn {stream, ref} ->
+        stream_close(stream)
+        flush_stream(ref)
+      end
+    )
+  end
+
+  ## Descarta as mensagens que chegaram depois que o Stream foi
+  ## interrompido; após o close nenhuma mensagem nova é enviada.
+  defp flush_stream(nil), do: :ok
+
+  defp flush_stream(ref) do
+    receive do
+      {^ref, _} -> flush_stream(ref)
+    after
+      0 -> :ok
+    end
+  end
+
+  ## NIFs usados por stream/3. stream_open devolve {:ok, stream, ref} e a
+  ## busca começa na hora: os blocos de até `rows_per_fetch` linhas chegam ao
+  ## processo que abriu o stream como {ref, {:rows, linhas}}, o último como
+  ## {ref, {:last, linhas}} e uma falha como {ref, {:error, msg}}.
+  ## stream_next/1 só confirma que um bloco foi tratado e libera a busca do
+  ## próximo; no máximo dois blocos ficam adiantados. Por isso não há um
+  ## stream_next/2 que devolve as linhas: entregar os blocos como mensagens
+  ## dispensa uma cópia dos termos, deixa a busca do próximo bloco correr
+  ## enquanto o atual é tratado e não prende um scheduler esperando o banco.
+  ## O tamanho do bloco é o do stream_open. Depois do stream_close nenhum
+  ## bloco novo é enviado.
+  def stream_open(_conn, _sql, _rows_per_fetch) do
+    raise "NIF stream_open not implemented"
+  end
+
+  def stream_next(_stream) do
+    raise "NIF stream_next not implemented"
+  end
+
+  def stream_close(_stream) do
+    raise "NIF stream_close not implemented"
+  end
+
+  ## Executa um bloco PL/SQL e devolve {:ok, resultados}, com as linhas de
+  ## cada resultado implícito (DBMS_SQL.RETURN_RESULT) numa lista, na ordem
+  ## em que o bloco os devolveu. Tudo é buscado numa única chamada, em
+  ## blocos de `rows_per_fetch` linhas; as idas ao banco são as mesmas de
+  ## buscar um resultado por vez, pois a sessão atende uma busca por vez.
+  def implicit_results(_conn, _sql, _rows_per_fetch) do
+    raise "NIF implicit_results not implemented"
+  end
+
+  def pool_create(_user, _password, _connect_string, _max_sessions) do
+    raise "NIF pool_create not implemented"
+  end
+
+  ## Estatísticas do pool para o :telemetry: sessões abertas e em uso,
+  ## checkouts, falhas e timeouts, tempos de espera (total, máximo e
+  ## histograma, em µs), sessões criadas e acertos de tag.
+  def pool_metrics(_pool) do
+    raise "NIF pool_metrics not implemented"
+  end
+
+  ## Abre e testa `sessions` sessões do pool antes do primeiro uso;
+  ## devolve {:ok, sessões abertas} ou {:error, mensagem}.
+  def pool_warmup(_pool, _sessions) do
+    raise "NIF pool_warmup not implemented"
+  end
+
+  ## Executa as consultas (SQL ou {SQL, valores}) ao mesmo tempo, cada uma
+  ## numa conexão do pool; devolve {:ok, linhas} ou {:error, mensagem} para
+  ## cada consulta, na mesma ordem.
+  def parallel_query(_pool, _queries) do
+    raise "NIF parallel_query not implemented"
+  end
+
+  ## Lê a tabela inteira dividida em faixas de ROWID de até `chunk_blocks`
+  ## blocos (DBMS_PARALLEL_EXECUTE; o usuário precisa do privilégio CREATE
+  ## JOB), cada faixa numa conexão do pool. Devolve um Stream com as linhas
+  ## de cada faixa na ordem em que as faixas terminam; no máximo duas faixas
+  ## por conexão ficam à frente do consumo. `table` ("TABELA" ou
+  ## "DONO.TABELA") e `columns` (lista de nomes) aceitam apenas nomes sem
+  ## aspas: letras, dígitos, _, $ e #.
+  def parallel_scan(pool, table, columns, chunk_blocks \\ 1000) do
+    Stream.resource(
+      fn ->
+        case parallel_scan_open(pool, table, columns, chunk_blocks) do
+          {:ok, scan, ref} -> {scan, ref}
+          {:error, message} -> raise message
+        end
+      end,
+      fn
+        {scan, nil} ->
+          {:halt, {scan, nil}}
+
+        {scan, ref} ->
+          receive do
+            {^ref, {:ok, rows}} ->
+              parallel_scan_next(scan)
+              {rows, {scan, ref}}
+
+            {^ref, :done} ->
+              {:halt, {scan, nil}}
+
+            {^ref, {:error, message}} ->
+              raise message
+          end
+      end,
+      fn {scan, ref} ->
+        parallel_scan_close(scan)
+        flush_stream(ref)
+      end
+    )
+  end
+
+  def parallel_scan_open(_pool, _table, _columns, _chunk_blocks) do
+    raise "NIF parallel_scan_open not implemented"
+  end
+
+  def parallel_scan_next(_scan) do
+    raise "NIF parallel_scan_next not implemented"
+  end
+
+  def parallel_scan_close(_scan) do
+    raise "NIF parallel_scan_close not implemented"
+  end
+
+  ## Conexões do pool mantidas abertas do lado do NIF, uma partição por
+  ## scheduler; o checkout só vai ao pool do OCI quando não há nenhuma livre.
+  ## Uma thread mantém ao menos `min_idle` conexões livres já abertas, testa
+  ## as que estão paradas e descarta as que falharam ou expiraram.
+  def conn_pool_create(_pool, _min_idle) do
+    raise "NIF conn_pool_create not implemented"
+  end
+
+  def conn_pool_checkout(_conn_pool) do
+    raise "NIF conn_pool_checkout not implemented"
+  end
+
+  ## Checkout de uma sessão no estado identificado por `tag`; devolve
+  ## {:ok, conn, true} se a tag foi encontrada ou {:ok, conn, false} se a
+  ## sessão ainda precisa ser ajustada (ALTER SESSION etc.).
+  def conn_pool_checkout(_conn_pool, _tag) do
+    raise "NIF conn_pool_checkout not implemented"
+  end
+
+  ## Devolve a conexão ao pool; depois disso ela não pode mais ser usada.
+  def conn_pool_checkin(_conn) do
+    raise "NIF conn_pool_checkin not implemented"
+  end
+
+  ## Devolve a conexão indicando com `tag` o estado em que a sessão ficou.
+  def conn_pool_checkin(_conn, _tag) do
+    raise "NIF conn_pool_checkin not implemented"
+  end
+
+  ## Lê o LOB retornado na primeira coluna da consulta como um Stream de
+  ## binários, em partes alinhadas ao chunk do LOB; a parte seguinte já vai
+  ## sendo lida enquanto a atual é consumida.
+  def lob_stream(conn, sql) do
+    Stream.resource(
+      fn ->
+        case lob_stream_open(conn, sql) do
+          {:ok, reader} -> reader
+          {:error, message} -> raise message
+        end
+      end,
+      fn reader ->
+        case lob_stream_next(reader) do
+          {:ok, piece} -> {[piece], reader}
+          :done -> {:halt, reader}
+          {:error, message} -> raise message
+        end
+      end,
+      &lob_stream_close/1
+    )
+  end
+
+  def lob_stream_open(_conn, _sql) do
+    raise "NIF lob_stream_open not implemented"
+  end
+
+  def lob_stream_next(_reader) do
+    raise "NIF lob_stream_next not implemented"
+  end
+
+  def lob_stream_close(_reader) do
+    raise "NIF lob_stream_close not implemented"
+  end
+
+  ## Lê de uma vez o LOB retornado na primeira coluna da consulta; o binário
+  ## é preenchido diretamente pelo OCI, sem cópia. Para LOBs grandes, prefira
+  ## lob_stream/2.
+  def lob_read(_conn, _sql) do
+    raise "NIF lob_read not implemented"
+  end
+
+  ## Grava no LOB retornado pela consulta (SELECT ... FOR UPDATE) os binários
+  ## de `enumerable`, parte a parte, sem juntar o conteúdo na memória; a
+  ## gravação segura o enumerable quando há partes demais na fila. Até o
+  ## lob_writer_close, as outras funções recusam a conexão (ArgumentError).
+  def lob_write(conn, sql, enumerable) do
+    with {:ok, writer} <- lob_writer_open(conn, sql) do
+      result =
+        Enum.reduce_while(enumerable, :ok, fn piece, :ok ->
+          case lob_writer_write(writer, piece) do
+            :ok -> {:cont, :ok}
+            error -> {:halt, error}
+          end
+        end)
+
+      case {result, lob_writer_close(writer)} do
+        {:ok, closed} -> closed
+        {error, _} -> error
+      end
+    end
+  end
+
+  def lob_writer_open(_conn, _sql) do
+    raise "NIF lob_writer_open not implemented"
+  end
+
+  def lob_writer_write(_writer, _data) do
+    raise "NIF lob_writer_write not implemented"
+  end
+
+  def lob_writer_close(_writer) do
+    raise "NIF lob_writer_close not implemented"
+  end
+
 
 end
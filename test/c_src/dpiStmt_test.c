@@ -0,0 +1,343 @@
+//-----------------------------------------------------------------------------
+// dpiStmt_test.c
+//   Checks of the blocks of rows retained by scrollable statements and of the
+// automatic adjustment of the fetch array size. No database or Oracle Client
+// is needed: the statement is built by hand with a single query variable (or
+// only its metadata) and each "fetch" sets the fields dpiStmt__fetch() would
+// set, with the rows and the time taken chosen by the test.
+//-----------------------------------------------------------------------------
+
+#include "dpiImpl.h"
+
+static int numFailures = 0;
+
+#define CHECK(condition) \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+                #condition); \
+        numFailures++; \
+    }
+
+// number of rows in each block fetched by the tests
+#define TEST_ROWS_PER_BLOCK             2
+
+// size of a row with a single column, estimated as the adjustment of the
+// fetch array size does it, and the number of rows in the buffers
+#define TEST_COLUMN_SIZE                22
+#define TEST_ROW_SIZE                   (TEST_COLUMN_SIZE + sizeof(dpiData) + \
+        sizeof(int16_t) + sizeof(uint32_t) + sizeof(uint16_t))
+#define TEST_MAX_ARRAY_SIZE             100
+
+
+//-----------------------------------------------------------------------------
+// createStmt()
+//   Create a scrollable statement with a single query variable of type
+// NATIVE_INT, defined on a connection that only carries the client version.
+//-----------------------------------------------------------------------------
+static dpiStmt *createStmt(dpiError *error)
+{
+    dpiVersionInfo *versionInfo;
+    dpiData *data;
+    dpiStmt *stmt;
+    dpiConn *conn;
+    dpiEnv *env;
+
+    versionInfo = calloc(1, sizeof(dpiVersionInfo));
+    env = calloc(1, sizeof(dpiEnv));
+    conn = calloc(1, sizeof(dpiConn));
+    stmt = calloc(1, sizeof(dpiStmt));
+    versionInfo->versionNum = 19;
+    env->versionInfo = versionInfo;
+    conn->env = env;
+    conn->refCount = 1;
+    stmt->conn = conn;
+    stmt->env = env;
+    stmt->scrollable = 1;
+    stmt->fetchArraySize = TEST_ROWS_PER_BLOCK;
+    stmt->numQueryVars = 1;
+    stmt->queryVars = calloc(1, sizeof(dpiVar*));
+    CHECK(dpiVar__allocate(conn, DPI_ORACLE_TYPE_NATIVE_INT,
+            DPI_NATIVE_TYPE_INT64, TEST_ROWS_PER_BLOCK, 0, 0, 0, NULL,
+            &stmt->queryVars[0], &data, error) == DPI_SUCCESS)
+    return stmt;
+}
+
+
+//-----------------------------------------------------------------------------
+// fetchBlock()
+//   Simulate the fetch of the block of rows starting at the given row. The
+// value of each row is its row number multiplied by ten.
+//-----------------------------------------------------------------------------
+static void fetchBlock(dpiStmt *stmt, uint64_t minRow)
+{
+    dpiVar *var = stmt->queryVars[0];
+    uint32_t i;
+
+    for (i = 0; i < TEST_ROWS_PER_BLOCK; i++) {
+        var->data.asInt64[i] = (int64_t) (minRow + i) * 10;
+        var->indicator[i] = DPI_OCI_IND_NOTNULL;
+    }
+    stmt->rowCount = minRow - 1;
+    stmt->bufferMinRow = minRow;
+    stmt->bufferRowCount = TEST_ROWS_PER_BLOCK;
+    stmt->bufferRowIndex = 0;
+    dpiStmt__saveScrollWindow(stmt);
+}
+
+
+//-----------------------------------------------------------------------------
+// checkRestore()
+//   Look for the given row in the retained blocks and, if it is expected to
+// be found, check that the query variable holds its block again.
+//-----------------------------------------------------------------------------
+static void checkRestore(dpiStmt *stmt, uint64_t row, int expectFound,
+        dpiError *error)
+{
+    uint64_t minRow;
+    dpiVar *var;
+    int found;
+
+    CHECK(dpiStmt__restoreScrollWindow(stmt, row, &found,
+            error) == DPI_SUCCESS)
+    CHECK(found == expectFound)
+    if (!found)
+        return;
+    var = stmt->queryVars[0];
+    minRow = row - (row - 1) % TEST_ROWS_PER_BLOCK;
+    CHECK(stmt->bufferMinRow == minRow)
+    CHECK(stmt->bufferRowIndex == row - minRow)
+    CHECK(stmt->rowCount == row - 1)
+    CHECK(stmt->scrollWindowRestored)
+    CHECK(var->data.asInt64[0] == (int64_t) minRow * 10)
+    CHECK(var->externalData[row - minRow].value.asInt64 ==
+            (int64_t) row * 10)
+}
+
+
+//-----------------------------------------------------------------------------
+// testScrollWindowLru()
+//   Only DPI_SCROLL_CACHE_MAX_WINDOWS blocks are retained; the least recently
+// used block, counting restores as uses, is the one replaced.
+//-----------------------------------------------------------------------------
+static void testScrollWindowLru(dpiError *error)
+{
+    dpiStmt *stmt;
+    uint64_t row;
+
+    // fetch one block more than can be retained; the first is replaced
+    stmt = createStmt(error);
+    for (row = 1; row <= (DPI_SCROLL_CACHE_MAX_WINDOWS + 1) *
+            TEST_ROWS_PER_BLOCK; row += TEST_ROWS_PER_BLOCK)
+        fetchBlock(stmt, row);
+    checkRestore(stmt, 1, 0, error);
+    checkRestore(stmt, 4, 1, error);
+    checkRestore(stmt, 9, 1, error);
+
+    // restoring rows 3-4 made that block recently used so the block with
+    // rows 5-6 is now the least recently used and is replaced
+    fetchBlock(stmt, 11);
+    checkRestore(stmt, 5, 0, error);
+    checkRestore(stmt, 3, 1, error);
+    checkRestore(stmt, 12, 1, error);
+
+    // fetching a block already retained replaces it instead of another one
+    fetchBlock(stmt, 7);
+    checkRestore(stmt, 3, 1, error);
+    checkRestore(stmt, 8, 1, error);
+    checkRestore(stmt, 10, 1, error);
+}
+
+
+//-----------------------------------------------------------------------------
+// testFetchModeAfterRestore()
+//   After a block was restored, the cursor is not positioned after it so the
+// next fetch of any relative kind is made absolute, once.
+//-----------------------------------------------------------------------------
+static void testFetchModeAfterRestore(dpiError *error)
+{
+    dpiFetchMode mode;
+    dpiStmt *stmt;
+    int32_t offset;
+    uint64_t row;
+
+    stmt = createStmt(error);
+    for (row = 1; row <= 3 * TEST_ROWS_PER_BLOCK; row += TEST_ROWS_PER_BLOCK)
+        fetchBlock(stmt, row);
+
+    // without a restore the mode is left alone
+    mode = DPI_MODE_FETCH_NEXT;
+    offset = 0;
+    dpiStmt__getFetchMode(stmt, 7, &mode, &offset);
+    CHECK(mode == DPI_MODE_FETCH_NEXT && offset == 0)
+
+    // after a restore, the next row is fetched by its absolute position
+    checkRestore(stmt, 2, 1, error);
+    mode = DPI_MODE_FETCH_NEXT;
+    dpiStmt__getFetchMode(stmt, 3, &mode, &offset);
+    CHECK(mode == DPI_MODE_FETCH_ABSOLUTE && offset == 3)
+    CHECK(!stmt->scrollWindowRestored)
+
+    // only the first fetch after the restore is affected
+    mode = DPI_MODE_FETCH_NEXT;
+    offset = 0;
+    dpiStmt__getFetchMode(stmt, 5, &mode, &offset);
+    CHECK(mode == DPI_MODE_FETCH_NEXT && offset == 0)
+
+    // prior and relative fetches are affected as well
+    checkRestore(stmt, 4, 1, error);
+    mode = DPI_MODE_FETCH_RELATIVE;
+    offset = -2;
+    dpiStmt__getFetchMode(stmt, 2, &mode, &offset);
+    CHECK(mode == DPI_MODE_FETCH_ABSOLUTE && offset == 2)
+
+    // first, last and absolute fetches already position the cursor
+    checkRestore(stmt, 6, 1, error);
+    mode = DPI_MODE_FETCH_LAST;
+    offset = 0;
+    dpiStmt__getFetchMode(stmt, 0, &mode, &offset);
+    CHECK(mode == DPI_MODE_FETCH_LAST && offset == 0)
+    CHECK(!stmt->scrollWindowRestored)
+}
+
+
+//-----------------------------------------------------------------------------
+// createAdaptiveStmt()
+//   Create a statement whose fetch array size is adjusted automatically to
+// buffers of TEST_MAX_ARRAY_SIZE rows. The query variable has not been
+// created yet so its size comes from the query metadata.
+//-----------------------------------------------------------------------------
+static dpiStmt *createAdaptiveStmt(uint32_t fetchArraySize)
+{
+    dpiStmt *stmt;
+
+    stmt = calloc(1, sizeof(dpiStmt));
+    stmt->numQueryVars = 1;
+    stmt->queryVars = calloc(1, sizeof(dpiVar*));
+    stmt->queryInfo = calloc(1, sizeof(dpiQueryInfo));
+    stmt->queryInfo[0].clientSizeInBytes = TEST_COLUMN_SIZE;
+    stmt->adaptiveFetchBufferSize =
+            (uint32_t) (TEST_ROW_SIZE * TEST_MAX_ARRAY_SIZE);
+    stmt->fetchArraySize = fetchArraySize;
+    return stmt;
+}
+
+
+//-----------------------------------------------------------------------------
+// adaptiveFetch()
+//   Simulate a fetch of the given number of rows taking the given time (in
+// microseconds) and adjust the fetch array size as the next fetch does.
+//-----------------------------------------------------------------------------
+static void adaptiveFetch(dpiStmt *stmt, uint32_t numRows, uint64_t time)
+{
+    stmt->lastFetchRows = numRows;
+    stmt->lastFetchTime = time;
+    dpiStmt__adjustFetchArraySize(stmt);
+}
+
+
+//-----------------------------------------------------------------------------
+// testAdaptiveFetchSize()
+//   The array size is limited to the rows that fit in the buffers and is
+// doubled after each full batch, up to that limit; partial batches and
+// fetches not yet measured leave it alone.
+//-----------------------------------------------------------------------------
+static void testAdaptiveFetchSize(dpiError *error)
+{
+    dpiStmt *stmt;
+
+    stmt = createAdaptiveStmt(1000);
+    dpiStmt__adjustFetchArraySize(stmt);
+    CHECK(stmt->fetchArraySize == TEST_MAX_ARRAY_SIZE)
+
+    stmt = createAdaptiveStmt(8);
+    dpiStmt__adjustFetchArraySize(stmt);
+    CHECK(stmt->fetchArraySize == 8)
+    adaptiveFetch(stmt, 8, 80);
+    CHECK(stmt->fetchArraySize == 16)
+    adaptiveFetch(stmt, 16, 160);
+    CHECK(stmt->fetchArraySize == 32)
+    adaptiveFetch(stmt, 20, 200);
+    CHECK(stmt->fetchArraySize == 32)
+    adaptiveFetch(stmt, 32, 320);
+    CHECK(stmt->fetchArraySize == 64)
+    adaptiveFetch(stmt, 64, 640);
+    CHECK(stmt->fetchArraySize == TEST_MAX_ARRAY_SIZE)
+    adaptiveFetch(stmt, TEST_MAX_ARRAY_SIZE, 1000);
+    CHECK(stmt->fetchArraySize == TEST_MAX_ARRAY_SIZE)
+}
+
+
+//-----------------------------------------------------------------------------
+// testAdaptiveFetchLatency()
+//   On a slow network each fetch takes long, whatever the number of rows;
+// the time per row still falls as the array size grows, so the array size
+// keeps growing instead of being halved again and again.
+//-----------------------------------------------------------------------------
+static void testAdaptiveFetchLatency(dpiError *error)
+{
+    uint32_t i, previousSize;
+    dpiStmt *stmt;
+
+    stmt = createAdaptiveStmt(1);
+    for (i = 0; i < 20; i++) {
+        previousSize = stmt->fetchArraySize;
+        adaptiveFetch(stmt, previousSize, 300000 + previousSize * 10);
+        CHECK(stmt->fetchArraySize >= previousSize)
+    }
+    CHECK(stmt->fetchArraySize == TEST_MAX_ARRAY_SIZE)
+}
+
+
+//-----------------------------------------------------------------------------
+// testAdaptiveFetchSlowdown()
+//   When the time per row rises well above the lowest seen, the array size is
+// halved and that size is not tried again during the execution.
+//-----------------------------------------------------------------------------
+static void testAdaptiveFetchSlowdown(dpiError *error)
+{
+    dpiStmt *stmt;
+
+    // 10 microseconds per row; then 40 per row is still acceptable
+    stmt = createAdaptiveStmt(32);
+    adaptiveFetch(stmt, 32, 320);
+    CHECK(stmt->fetchArraySize == 64)
+    adaptiveFetch(stmt, 64, 64 * 40);
+    CHECK(stmt->fetchArraySize == TEST_MAX_ARRAY_SIZE)
+
+    // 50 per row is too slow
+    adaptiveFetch(stmt, TEST_MAX_ARRAY_SIZE, TEST_MAX_ARRAY_SIZE * 50);
+    CHECK(stmt->fetchArraySize == TEST_MAX_ARRAY_SIZE / 2)
+    adaptiveFetch(stmt, TEST_MAX_ARRAY_SIZE / 2, 500);
+    CHECK(stmt->fetchArraySize == TEST_MAX_ARRAY_SIZE / 2)
+    adaptiveFetch(stmt, TEST_MAX_ARRAY_SIZE / 2, 500);
+    CHECK(stmt->fetchArraySize == TEST_MAX_ARRAY_SIZE / 2)
+
+    // very fast fetches (under a microsecond) are not taken as slowdowns
+    stmt = createAdaptiveStmt(4);
+    adaptiveFetch(stmt, 4, 0);
+    CHECK(stmt->fetchArraySize == 8)
+    adaptiveFetch(stmt, 8, 1);
+    CHECK(stmt->fetchArraySize == 16)
+}
+
+
+int main(int argc, char **argv)
+{
+    dpiErrorBuffer buffer;
+    dpiError error;
+
+    memset(&error, 0, sizeof(error));
+    memset(&buffer, 0, sizeof(buffer));
+    error.buffer = &buffer;
+    testScrollWindowLru(&error);
+    testFetchModeAfterRestore(&error);
+    testAdaptiveFetchSize(&error);
+    testAdaptiveFetchLatency(&error);
+    testAdaptiveFetchSlowdown(&error);
+    if (numFailures > 0) {
+        fprintf(stderr, "dpiStmt_test: %d check(s) failed\n", numFailures);
+        return 1;
+    }
+    printf("dpiStmt_test: all checks passed\n");
+    return 0;
+}
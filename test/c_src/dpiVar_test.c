@@ -0,0 +1,131 @@
+//-----------------------------------------------------------------------------
+// dpiVar_test.c
+//   Checks of the actual length arrays of variables. No database or Oracle
+// Client is needed: the variables are allocated on a connection that only
+// carries the client version, since the choice between the 16-bit and 32-bit
+// arrays depends on it.
+//-----------------------------------------------------------------------------
+
+#include "dpiImpl.h"
+
+static int numFailures = 0;
+
+#define CHECK(condition) \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+                #condition); \
+        numFailures++; \
+    }
+
+
+//-----------------------------------------------------------------------------
+// createConn()
+//   Create a connection structure usable by dpiVar__allocate() for a client of
+// the given version.
+//-----------------------------------------------------------------------------
+static dpiConn *createConn(int versionNum)
+{
+    dpiVersionInfo *versionInfo;
+    dpiConn *conn;
+    dpiEnv *env;
+
+    versionInfo = calloc(1, sizeof(dpiVersionInfo));
+    env = calloc(1, sizeof(dpiEnv));
+    conn = calloc(1, sizeof(dpiConn));
+    versionInfo->versionNum = versionNum;
+    env->versionInfo = versionInfo;
+    conn->env = env;
+    conn->refCount = 1;
+    return conn;
+}
+
+
+//-----------------------------------------------------------------------------
+// setLength()
+//   Set the length of a value the way dpiVar_setFromBytes() does for buffers
+// filled in place.
+//-----------------------------------------------------------------------------
+static void setLength(dpiVar *var, uint32_t pos, uint32_t length,
+        dpiError *error)
+{
+    dpiData data;
+
+    memset(&data, 0, sizeof(data));
+    data.value.asBytes.length = length;
+    CHECK(dpiVar__setValue(var, pos, &data, error) == DPI_SUCCESS)
+}
+
+
+//-----------------------------------------------------------------------------
+// testLength16()
+//   An 11g client keeps the 16-bit array for the life of the variable: a
+// dynamic bind adds the 32-bit array used by the callbacks and a later static
+// bind or define goes back to the 16-bit array, with the lengths set meanwhile.
+//-----------------------------------------------------------------------------
+static void testLength16(dpiError *error)
+{
+    dpiData *data;
+    dpiVar *var;
+
+    CHECK(dpiVar__allocate(createConn(11), DPI_ORACLE_TYPE_VARCHAR,
+            DPI_NATIVE_TYPE_BYTES, 3, 10, 1, 0, NULL, &var, &data,
+            error) == DPI_SUCCESS)
+    CHECK(var->actualLength16 && !var->actualLength32)
+    setLength(var, 0, 5, error);
+    CHECK(var->actualLength16[0] == 5)
+
+    CHECK(dpiVar__convertToLength32(var, error) == DPI_SUCCESS)
+    CHECK(var->actualLength16 && var->actualLength32)
+    CHECK(var->actualLength32[0] == 5)
+    setLength(var, 1, 7, error);
+    CHECK(var->actualLength32[1] == 7)
+
+    dpiVar__restoreLength16(var);
+    CHECK(var->actualLength16 && !var->actualLength32)
+    CHECK(var->actualLength16[0] == 5 && var->actualLength16[1] == 7)
+    setLength(var, 2, 3, error);
+    CHECK(var->actualLength16[2] == 3)
+
+    CHECK(dpiVar__convertToLength32(var, error) == DPI_SUCCESS)
+    CHECK(var->actualLength32 && var->actualLength32[2] == 3)
+}
+
+
+//-----------------------------------------------------------------------------
+// testLength32()
+//   Clients from 12c onwards only ever use the 32-bit array.
+//-----------------------------------------------------------------------------
+static void testLength32(dpiError *error)
+{
+    dpiData *data;
+    dpiVar *var;
+
+    CHECK(dpiVar__allocate(createConn(12), DPI_ORACLE_TYPE_VARCHAR,
+            DPI_NATIVE_TYPE_BYTES, 3, 10, 1, 0, NULL, &var, &data,
+            error) == DPI_SUCCESS)
+    CHECK(!var->actualLength16 && var->actualLength32)
+    CHECK(dpiVar__convertToLength32(var, error) == DPI_SUCCESS)
+    dpiVar__restoreLength16(var);
+    CHECK(!var->actualLength16 && var->actualLength32)
+    setLength(var, 0, 9, error);
+    CHECK(var->actualLength32[0] == 9)
+}
+
+
+int main(int argc, char **argv)
+{
+    dpiErrorBuffer buffer;
+    dpiError error;
+
+    memset(&error, 0, sizeof(error));
+    memset(&buffer, 0, sizeof(buffer));
+    error.buffer = &buffer;
+    testLength16(&error);
+    testLength32(&error);
+    if (numFailures > 0) {
+        fprintf(stderr, "dpiVar_test: %d check(s) failed\n", numFailures);
+        return 1;
+    }
+    printf("dpiVar_test: all checks passed\n");
+    return 0;
+}
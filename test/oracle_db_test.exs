@@ -0,0 +1,358 @@
+defmodule OracleNifDbTest do
+  use ExUnit.Case
+  @moduletag :oracle
+
+  alias OracleNif.TestDB
+
+  @numbers "SELECT CAST(LEVEL AS NUMBER(10)) FROM dual CONNECT BY LEVEL <= 2500"
+
+  describe "stream/3" do
+    test "devolve todas as linhas, em blocos" do
+      rows = OracleNif.stream(TestDB.conn(), @numbers, 100) |> Enum.to_list()
+      assert rows == Enum.map(1..2500, &[&1])
+    end
+
+    test "interrompido no meio, fecha o cursor e não deixa mensagens" do
+      rows = OracleNif.stream(TestDB.conn(), @numbers, 100) |> Enum.take(150)
+      assert length(rows) == 150
+      refute_receive {_, {_, _}}, 100
+    end
+
+    test "consulta vazia" do
+      sql = "SELECT 1 FROM dual WHERE 1 = 0"
+      assert OracleNif.stream(TestDB.conn(), sql, 10) |> Enum.to_list() == []
+    end
+
+    test "erro na busca é levantado" do
+      sql = "SELECT 1 / (500 - LEVEL) FROM dual CONNECT BY LEVEL <= 1000"
+
+      assert_raise RuntimeError, ~r/ORA-01476/, fn ->
+        OracleNif.stream(TestDB.conn(), sql, 100) |> Enum.to_list()
+      end
+    end
+  end
+
+  describe "colunas REF cursor" do
+    test "são buscadas em vários blocos sem esgotar os cursores" do
+      # mais cursores do que o OPEN_CURSORS padrão (300), 100 por bloco; os
+      # dpiStmt de um bloco são reaproveitados no seguinte e, se o cursor
+      # anterior não fosse fechado, a busca falharia com ORA-01000
+      sql = """
+      SELECT CAST(LEVEL AS NUMBER(10)),
+             CURSOR(SELECT LEVEL FROM dual CONNECT BY LEVEL <= 3)
+      FROM dual CONNECT BY LEVEL <= 1000
+      """
+
+      rows = OracleNif.stream(TestDB.conn(), sql, 100) |> Enum.to_list()
+      assert rows == Enum.map(1..1000, &[&1, :unsupported])
+    end
+  end
+
+  describe "implicit_results/3" do
+    test "devolve as linhas de todos os resultados, na ordem" do
+      # mais resultados do que os obtidos por vez pelo NIF (16), cada um com
+      # mais linhas do que rows_per_fetch
+      sql = """
+      DECLARE
+        c SYS_REFCURSOR;
+      BEGIN
+        FOR i IN 1..18 LOOP
+          OPEN c FOR
+            SELECT CAST(i * 10 + LEVEL AS NUMBER(10)) FROM dual
+            CONNECT BY LEVEL <= 5;
+          DBMS_SQL.RETURN_RESULT(c);
+        END LOOP;
+        OPEN c FOR SELECT 'a' FROM dual WHERE 1 = 0;
+        DBMS_SQL.RETURN_RESULT(c);
+      END;
+      """
+
+      expected =
+        Enum.map(1..18, fn i -> Enum.map(1..5, &[i * 10 + &1]) end) ++ [[]]
+
+      assert OracleNif.implicit_results(TestDB.conn(), sql, 2) ==
+               {:ok, expected}
+    end
+
+    test "bloco sem resultados implícitos" do
+      sql = "BEGIN NULL; END;"
+      assert OracleNif.implicit_results(TestDB.conn(), sql, 10) == {:ok, []}
+    end
+
+    test "erro no bloco" do
+      sql = "BEGIN RAISE_APPLICATION_ERROR(-20001, 'falhou'); END;"
+
+      assert {:error, message} =
+               OracleNif.implicit_results(TestDB.conn(), sql, 10)
+
+      assert message =~ "ORA-20001"
+    end
+  end
+
+  describe "parallel_query/2" do
+    test "devolve o resultado de cada consulta, na ordem" do
+      queries = [
+        {"SELECT CAST(:1 + 1 AS NUMBER(10)) FROM dual", [1]},
+        "SELECT 'a' FROM dual",
+        "SELECT * FROM tabela_que_nao_existe"
+      ]
+
+      assert [{:ok, [[2]]}, {:ok, [["a"]]}, {:error, message}] =
+               OracleNif.parallel_query(TestDB.pool(), queries)
+
+      assert message =~ "ORA-00942"
+    end
+  end
+
+  describe "parallel_scan/4" do
+    setup do
+      pool = TestDB.pool()
+      TestDB.drop_table(pool, "oracle_nif_scan")
+
+      TestDB.execute(pool, """
+      create table oracle_nif_scan as
+      select cast(level as number(10)) id, 'linha ' || level name
+      from dual connect by level <= 20000
+      """)
+
+      on_exit(fn -> TestDB.drop_table(TestDB.pool(1), "oracle_nif_scan") end)
+      {:ok, pool: pool}
+    end
+
+    test "lê todas as linhas, faixa por faixa", %{pool: pool} do
+      rows =
+        OracleNif.parallel_scan(pool, "oracle_nif_scan", ["id", "name"], 8)
+        |> Enum.sort()
+
+      assert rows == Enum.map(1..20000, &[&1, "linha #{&1}"])
+    end
+
+    test "interrompido no meio, não deixa mensagens", %{pool: pool} do
+      rows = OracleNif.parallel_scan(pool, "oracle_nif_scan", ["id"], 8)
+      assert length(Enum.take(rows, 10)) == 10
+      refute_receive {_, _}, 100
+    end
+
+    test "recusa nomes que não são identificadores", %{pool: pool} do
+      assert_raise ArgumentError, fn ->
+        OracleNif.parallel_scan_open(pool, "dual; drop table x", ["id"], 8)
+      end
+
+      assert_raise ArgumentError, fn ->
+        OracleNif.parallel_scan_open(pool, "oracle_nif_scan", ["1 id"], 8)
+      end
+
+      assert_raise ArgumentError, fn ->
+        OracleNif.parallel_scan_open(pool, "oracle_nif_scan", ["\"id\""], 8)
+      end
+    end
+  end
+
+  describe "lob_stream/2 e lob_read/2" do
+    setup do
+      pool = TestDB.pool(1)
+      TestDB.drop_table(pool, "oracle_nif_lob")
+      TestDB.execute(pool, "create table oracle_nif_lob (id number, c clob)")
+
+      # 3 milhões de caracteres: mais de uma parte no lob_stream
+      TestDB.execute(pool, """
+      declare
+        l clob;
+      begin
+        insert into oracle_nif_lob values (1, empty_clob()) returning c into l;
+        for i in 1 .. 300 loop
+          dbms_lob.writeappend(l, 10000, rpad(mod(i, 10), 10000, mod(i, 10)));
+        end loop;
+        insert into oracle_nif_lob values (2, null);
+        commit;
+      end;
+      """)
+
+      on_exit(fn -> TestDB.drop_table(TestDB.pool(1), "oracle_nif_lob") end)
+      :ok
+    end
+
+    @lob "SELECT c FROM oracle_nif_lob WHERE id = 1"
+    @null_lob "SELECT c FROM oracle_nif_lob WHERE id = 2"
+
+    defp lob_content do
+      Enum.map_join(1..300, &String.duplicate(to_string(rem(&1, 10)), 10000))
+    end
+
+    test "lob_stream devolve o LOB inteiro, em partes" do
+      pieces = OracleNif.lob_stream(TestDB.conn(), @lob) |> Enum.to_list()
+      assert length(pieces) > 1
+      assert IO.iodata_to_binary(pieces) == lob_content()
+    end
+
+    test "lob_stream interrompido e LOB nulo" do
+      assert [_] = OracleNif.lob_stream(TestDB.conn(), @lob) |> Enum.take(1)
+      assert OracleNif.lob_stream(TestDB.conn(), @null_lob) |> Enum.to_list() == []
+    end
+
+    test "lob_read devolve o LOB inteiro" do
+      assert OracleNif.lob_read(TestDB.conn(), @lob) == {:ok, lob_content()}
+      assert OracleNif.lob_read(TestDB.conn(), @null_lob) == {:ok, nil}
+    end
+
+    test "lob_read de um LOB temporário curto" do
+      sql = "SELECT TO_CLOB('abc') FROM dual"
+      assert OracleNif.lob_read(TestDB.conn(), sql) == {:ok, "abc"}
+    end
+  end
+
+  describe "LOBs inline" do
+    setup do
+      pool = TestDB.pool(1)
+      TestDB.drop_table(pool, "oracle_nif_inline")
+      TestDB.execute(pool, "create table oracle_nif_inline (id number(10), c clob, b blob)")
+
+      # a linha 2 passa, e muito, do tamanho pedido para o inline
+      TestDB.execute(pool, """
+      declare
+        l clob;
+      begin
+        insert into oracle_nif_inline values (1, 'abc', hextoraw('0102'));
+        insert into oracle_nif_inline values (2, empty_clob(), null)
+          returning c into l;
+        for i in 1 .. 10 loop
+          dbms_lob.writeappend(l, 10000, rpad('x', 10000, 'x'));
+        end loop;
+        commit;
+      end;
+      """)
+
+      on_exit(fn -> TestDB.drop_table(TestDB.pool(1), "oracle_nif_inline") end)
+      :ok
+    end
+
+    test "valores pequenos e maiores que o tamanho pedido" do
+      conn = TestDB.conn()
+      assert OracleNif.conn_set_inline_lob_size(conn, 100) == :ok
+
+      sql = "SELECT id, c, b FROM oracle_nif_inline ORDER BY id"
+
+      assert OracleNif.stream(conn, sql, 10) |> Enum.to_list() == [
+               [1, "abc", <<1, 2>>],
+               [2, String.duplicate("x", 100_000), nil]
+             ]
+    end
+  end
+
+  describe "lob_write/3" do
+    setup do
+      pool = TestDB.pool(1)
+      TestDB.drop_table(pool, "oracle_nif_lob_write")
+      TestDB.execute(pool, "create table oracle_nif_lob_write (id number, b blob)")
+
+      TestDB.execute(pool, """
+      begin
+        insert into oracle_nif_lob_write values (1, empty_blob());
+        commit;
+      end;
+      """)
+
+      on_exit(fn -> TestDB.drop_table(TestDB.pool(1), "oracle_nif_lob_write") end)
+      :ok
+    end
+
+    @for_update "SELECT b FROM oracle_nif_lob_write WHERE id = 1 FOR UPDATE"
+    @blob "SELECT b FROM oracle_nif_lob_write WHERE id = 1"
+
+    test "grava em partes e lê de volta" do
+      conn = TestDB.conn()
+      pieces = Enum.map(1..10, &:binary.copy(<<&1>>, 100_000))
+
+      assert OracleNif.lob_write(conn, @for_update, pieces) == :ok
+      assert OracleNif.lob_read(conn, @blob) == {:ok, IO.iodata_to_binary(pieces)}
+
+      streamed = OracleNif.lob_stream(conn, @blob) |> Enum.to_list()
+      assert IO.iodata_to_binary(streamed) == IO.iodata_to_binary(pieces)
+    end
+
+    test "uma única parte substitui o conteúdo anterior" do
+      conn = TestDB.conn()
+      assert OracleNif.lob_write(conn, @for_update, ["abcdef"]) == :ok
+      assert OracleNif.lob_write(conn, @for_update, ["xyz"]) == :ok
+      assert OracleNif.lob_read(conn, @blob) == {:ok, "xyz"}
+    end
+
+    test "a conexão fica ocupada até o lob_writer_close" do
+      conn = TestDB.conn()
+      assert {:ok, writer} = OracleNif.lob_writer_open(conn, @for_update)
+      assert OracleNif.lob_writer_write(writer, "abc") == :ok
+
+      assert_raise ArgumentError, fn -> OracleNif.lob_read(conn, @blob) end
+      assert_raise ArgumentError, fn -> OracleNif.lob_writer_open(conn, @for_update) end
+
+      assert OracleNif.lob_writer_close(writer) == :ok
+      assert OracleNif.lob_read(conn, @blob) == {:ok, "abc"}
+    end
+  end
+
+  describe "conn_pool" do
+    setup do
+      {:ok, conn_pool} = OracleNif.conn_pool_create(TestDB.pool(2), 1)
+      {:ok, conn_pool: conn_pool}
+    end
+
+    @one "SELECT CAST(1 AS NUMBER(10)) FROM dual"
+
+    test "checkout e checkin sem tag", %{conn_pool: conn_pool} do
+      assert {:ok, conn} = OracleNif.conn_pool_checkout(conn_pool)
+      assert OracleNif.stream(conn, @one) |> Enum.to_list() == [[1]]
+      assert OracleNif.conn_pool_checkin(conn) == :ok
+
+      # depois do checkin a conexão não pode mais ser usada
+      assert_raise ArgumentError, fn -> OracleNif.conn_pool_checkin(conn) end
+      assert_raise ArgumentError, fn -> OracleNif.stream_open(conn, @one, 1) end
+
+      assert {:ok, conn} = OracleNif.conn_pool_checkout(conn_pool)
+      assert OracleNif.conn_pool_checkin(conn) == :ok
+    end
+
+    test "checkout com tag", %{conn_pool: conn_pool} do
+      assert {:ok, conn, _} = OracleNif.conn_pool_checkout(conn_pool, "a=1")
+      assert OracleNif.conn_pool_checkin(conn, "a=1") == :ok
+
+      assert {:ok, conn, true} = OracleNif.conn_pool_checkout(conn_pool, "a=1")
+      assert OracleNif.stream(conn, @one) |> Enum.to_list() == [[1]]
+      assert OracleNif.conn_pool_checkin(conn) == :ok
+
+      assert {:ok, conn, false} = OracleNif.conn_pool_checkout(conn_pool, "b=2")
+      assert OracleNif.conn_pool_checkin(conn, "b=2") == :ok
+    end
+
+    test "checkout sem tag usa conexões livres com tag", %{conn_pool: conn_pool} do
+      # o pool tem 2 sessões, as duas devolvidas com tag: os checkouts sem
+      # tag precisam delas, pois o dpiPool não tem mais sessões para dar
+      assert {:ok, conn1, _} = OracleNif.conn_pool_checkout(conn_pool, "a=1")
+      assert {:ok, conn2, _} = OracleNif.conn_pool_checkout(conn_pool, "b=2")
+      assert OracleNif.conn_pool_checkin(conn1, "a=1") == :ok
+      assert OracleNif.conn_pool_checkin(conn2, "b=2") == :ok
+
+      assert {:ok, conn1} = OracleNif.conn_pool_checkout(conn_pool)
+      assert {:ok, conn2} = OracleNif.conn_pool_checkout(conn_pool)
+      assert OracleNif.stream(conn2, @one) |> Enum.to_list() == [[1]]
+      assert OracleNif.conn_pool_checkin(conn1) == :ok
+      assert OracleNif.conn_pool_checkin(conn2) == :ok
+    end
+
+    test "conexões sem checkin voltam para o pool", %{conn_pool: conn_pool} do
+      # o pool tem 2 sessões: sem a devolução das abandonadas, o terceiro
+      # checkout ficaria esperando
+      for _ <- 1..5 do
+        task =
+          Task.async(fn ->
+            {:ok, _conn} = OracleNif.conn_pool_checkout(conn_pool)
+            :ok
+          end)
+
+        assert Task.await(task) == :ok
+      end
+
+      assert {:ok, conn} = OracleNif.conn_pool_checkout(conn_pool)
+      assert OracleNif.conn_pool_checkin(conn) == :ok
+    end
+  end
+end
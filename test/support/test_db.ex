@@ -0,0 +1,35 @@
+defmodule OracleNif.TestDB do
+  ## Banco usado pelos testes marcados com @moduletag :oracle, que só rodam
+  ## quando ORACLE_NIF_TEST_DSN está definida (ver test_helper.exs). Usuário
+  ## e senha vêm de ORACLE_NIF_TEST_USER e ORACLE_NIF_TEST_PASSWORD.
+
+  def conn do
+    {:ok, conn} = OracleNif.get_conn(user(), password(), dsn())
+    conn
+  end
+
+  def pool(max_sessions \\ 4) do
+    {:ok, pool} = OracleNif.pool_create(user(), password(), dsn(), max_sessions)
+    pool
+  end
+
+  ## Executa um comando (DDL, DML ou PL/SQL) numa conexão do pool.
+  def execute(pool, sql) do
+    [{:ok, _}] = OracleNif.parallel_query(pool, [sql])
+    :ok
+  end
+
+  def drop_table(pool, table) do
+    execute(pool, """
+    begin
+      execute immediate 'drop table #{table} purge';
+    exception
+      when others then null;
+    end;
+    """)
+  end
+
+  defp user, do: System.get_env("ORACLE_NIF_TEST_USER", "")
+  defp password, do: System.get_env("ORACLE_NIF_TEST_PASSWORD", "")
+  defp dsn, do: System.get_env("ORACLE_NIF_TEST_DSN", "")
+end